@@ -19,30 +19,19 @@ void collapse(int argc, char *argv[]) {
 
   /************************************************************************
    ******* read the tree and rooting by topology and branch ***************/
-  Node *aTree = new Node;
-  aTree->innwk(myargs.infile);
+  NodePool pool;
+  Node *aTree = pool.newNode();
+  aTree->innwk(myargs.infile, true);
 
   // rooting the tree by outgroup and branch length
-  if (aTree->children.size() == 2) {
-    theInfo("This tree is a rooted tree, keep as it is");
-  } else if (myargs.byBranch) {
-    aTree = aTree->rootingByLength(myargs.rootMeth);
-  } else if (!myargs.outgrp.empty()) {
-    // root the unrooted tree by input outgroup name
-    Node *result = aTree->rootingByOutgrp(myargs.outgrp);
-    if (result == NULL) {
-      theInfo("Rooting the tree by branch length");
-      aTree = aTree->rootingByLength(myargs.rootMeth);
-    } else {
-      aTree = result;
-    }
-  }
+  aTree = rootingByInput(aTree, myargs.byBranch, myargs.outgrp,
+                         myargs.rootMeth);
 
   /**********************************************************************
    ********* set for the lineage system and get lineage *****************/
-  TaxaRank *rank = TaxaRank::create();
-  rank->initial(myargs.rankfile, myargs.outrank);
-  LngData lngs(myargs.taxadb, myargs.taxfile, myargs.taxrev);
+  TaxaRank rank;
+  rank.initial(myargs.rankfile, myargs.outrank);
+  LngData lngs(&rank, myargs.taxadb, myargs.taxfile, myargs.taxrev);
 
   // get the leafs lineage
   vector<Node *> allLeafs;
@@ -65,14 +54,7 @@ void collapse(int argc, char *argv[]) {
   }
 
   // rooting the tree by taxonomy
-  if (aTree->children.size() > 2) {
-    // rooting tree by taxonomy
-    aTree = aTree->rootingByTaxa();
-    size_t otulvl = 0;
-    if (!myargs.otuLevel.empty())
-      otulvl = rank->rankindex(myargs.otuLevel);
-    aTree->balanceTree(myargs.rootMeth, otulvl);
-  }
+  aTree = rootingByLineage(aTree, myargs.rootMeth, myargs.otuLevel, rank);
 
   // finaly annotate the rooted tree by lineage
   aTree->annotateRootedTree();
@@ -103,10 +85,61 @@ void collapse(int argc, char *argv[]) {
  ******************************  End main program ***************************
  ****************************************************************************/
 
+/**************************************************************************
+ * @brief root the tree before lineages of leafs: keep the rooted tree, or
+ * root it by branch length, or by the outgroup
+ *
+ * @param aTree the input tree
+ * @param byBranch rooting by branch length
+ * @param outgrp the name of outgroup leaf, empty for none
+ * @param meth the method of rooting by branch length
+ * @return Node* the tree, unrooted if neither is given
+ ***************************************************************************/
+Node *rootingByInput(Node *aTree, bool byBranch, const string &outgrp,
+                     const string &meth) {
+  if (aTree->children.size() == 2) {
+    theInfo("This tree is a rooted tree, keep as it is");
+  } else if (byBranch) {
+    aTree = aTree->rootingByLength(meth);
+  } else if (!outgrp.empty()) {
+    // root the unrooted tree by input outgroup name
+    Node *result = aTree->rootingByOutgrp(outgrp);
+    if (result == NULL) {
+      theInfo("Rooting the tree by branch length");
+      aTree = aTree->rootingByLength(meth);
+    } else {
+      aTree = result;
+    }
+  }
+  return aTree;
+};
+
+/**************************************************************************
+ * @brief root the unrooted tree by the lineages of leafs
+ *
+ * @param aTree the tree with lineages of leafs
+ * @param meth the method of rooting by branch length
+ * @param otuLevel the taxon level for OTU, empty for the top division
+ * @param rank the ranks of lineages
+ * @return Node* the rooted tree
+ ***************************************************************************/
+Node *rootingByLineage(Node *aTree, const string &meth, const string &otuLevel,
+                       const TaxaRank &rank) {
+  if (aTree->children.size() > 2) {
+    aTree = aTree->rootingByTaxa();
+    size_t otulvl = 0;
+    if (!otuLevel.empty())
+      otulvl = rank.rankindex(otuLevel);
+    aTree->balanceTree(meth, otulvl);
+  }
+  return aTree;
+};
+
 RunArgs::RunArgs(int argc, char **argv)
-    : infile(""), taxrev(""), outgrp(""), taxfile(""), forWeb(false),
-      forApp(false), predict(false), itol(false), byBranch(false), lngfile(""),
-      clevel(""), rootMeth("mv"), otuLevel("") {
+    : infile(""), taxfile(""), taxrev(""), lngfile(""), outgrp(""),
+      clevel(""), rootMeth("mv"), otuLevel(""), forWeb(false), forApp(false),
+      predict(false), itol(false), byBranch(false), gzip(false),
+      binary(false) {
 
   program = argv[0];
   string outname("collapsed");
@@ -115,7 +148,7 @@ RunArgs::RunArgs(int argc, char **argv)
 
   char ch;
   while ((ch = getopt(argc, argv,
-                      "i:d:D:o:S:r:t:s:T:R:O:L:l:C:m:u:BIWPAJqh")) != -1) {
+                      "i:d:D:o:S:r:t:s:T:R:O:L:l:C:m:u:BIWPAZbJqh")) != -1) {
     switch (ch) {
     case 'i':
       infile = optarg;
@@ -171,6 +204,12 @@ RunArgs::RunArgs(int argc, char **argv)
     case 'P':
       predict = true;
       break;
+    case 'Z':
+      gzip = true;
+      break;
+    case 'b':
+      binary = true;
+      break;
     case 'q':
       theInfo.quiet = true;
       break;
@@ -244,6 +283,8 @@ void RunArgs::usage() {
       << " [ -C <None> ]          Collapse on the taxon level for itol,\n"
       << "                        default: the top division taxon level\n"
       << " [ -P ]                 Output prediction for undefined leafs\n"
+      << " [ -Z ]                 Output the newick trees in gzip format\n"
+      << " [ -b ]                 Output the annotated tree in binary format\n"
       << " [ -q ]                 Run command in quiet mode\n"
       << " [ -h ]                 Display this information\n"
       << endl;
@@ -285,10 +326,15 @@ void output(const LngData &lngs, Taxa &aTaxa, Node *aTree, RunArgs &myargs) {
       outItolCollapse(nodes, division, myargs.outPref);
     }
   } else {
-    aTree->outnwk(myargs.outPref + "-annotated.nwk");
-    aTree->outnwk(myargs.outPref + "-rooted.nwk", false);
+    string suffix = myargs.gzip ? ".nwk.gz" : ".nwk";
+    aTree->outnwk(myargs.outPref + "-annotated" + suffix);
+    aTree->outnwk(myargs.outPref + "-rooted" + suffix, false);
   }
 
+  /// output the annotated tree in binary format for reloading
+  if (myargs.binary)
+    aTree->outbin(myargs.outPref + "-annotated.ctb");
+
   // for undefined items
   if (myargs.predict && aTree->nxleaf > 0) {
     /// output the unclassified items
@@ -398,17 +444,18 @@ void outItolNodes(const vector<Node *> &nodes, const string &file) {
   ofstream os(file);
   for (auto &nd : nodes) {
 
+    string nm(nd->getName());
     if (nd->isLeaf()) {
       os << nd->id << "\t"
          << "leaf"
-         << "\t" << nd->name.substr(nd->name.find_first_of('|') + 1);
+         << "\t" << nm.substr(nm.find_first_of('|') + 1);
     } else {
       os << "I" << nd->id << "\t";
       int nlvl = nd->taxLevel - nd->parent->taxLevel;
       if (nd->nleaf > 0 && nlvl > 0) {
-        string lngstr = nd->name;
+        string lngstr = nm;
         lngstr.erase(remove(lngstr.begin(), lngstr.end(), '|'), lngstr.end());
-        vector<string> lngvec;
+        vector<string_view> lngvec;
         separateLineage(lngstr, lngvec);
         os << "clade"
            << "\t";
@@ -416,7 +463,7 @@ void outItolNodes(const vector<Node *> &nodes, const string &file) {
           os << lngvec[i];
       } else {
         os << "-"
-           << "\t" << nd->name.substr(nd->name.find_first_of('|') + 1);
+           << "\t" << nm.substr(nm.find_first_of('|') + 1);
       }
     }
 
@@ -432,9 +479,9 @@ void outItolLabel(const vector<Node *> &nodes, const string &file) {
   os << "DATA\n" << endl;
   for (auto &nd : nodes) {
     if (nd->isLeaf()) {
-      os << nd->id << "\t" << lastNameNoRank(nd->name) << endl;
+      os << nd->id << "\t" << lastNameNoRankView(nd->getName()) << endl;
     } else if (nd->taxLevel > nd->parent->taxLevel) {
-      os << "I" + to_string(nd->id) << "\t" << lastNameNoRank(nd->name) << endl;
+      os << "I" + to_string(nd->id) << "\t" << lastNameNoRankView(nd->getName()) << endl;
     }
   }
 
@@ -488,7 +535,7 @@ void outItolStrap(const vector<Node *> &nodes, const map<string, TaxonState> &di
     if (nd->unclassified)
       continue;
 
-    string lngstr = nd->name;
+    string lngstr = nd->getName();
     lngstr.erase(remove(lngstr.begin(), lngstr.end(), '|'), lngstr.end());
     vector<string> nmlist;
     parseLineage(lngstr, nmlist);
@@ -498,7 +545,7 @@ void outItolStrap(const vector<Node *> &nodes, const map<string, TaxonState> &di
         if (!nd->isLeaf())
           os << "I";
         os << to_string(nd->id) << "\t" << iter->second << "\t"
-           << lastNameNoRank(iter->first) << endl;
+           << lastNameNoRankView(iter->first) << endl;
       }
     }
   }
@@ -530,12 +577,12 @@ void outItolCollapse(const vector<Node *> &nodes, const map<string, TaxonState>
         lab << nd->id;
       }
 
-      string lngstr = nd->name;
+      string lngstr = nd->getName();
       lngstr.erase(remove(lngstr.begin(), lngstr.end(), '|'), lngstr.end());
       vector<string> nmlist;
       parseLineage(lngstr, nmlist);
       string taxName = nmlist[theRank - 1];
-      lab << "\t" << lastNameNoRank(taxName) << "{" << nd->nleaf;
+      lab << "\t" << lastNameNoRankView(taxName) << "{" << nd->nleaf;
       size_t taxSize = division.find(nmlist[theRank - 1])->second.nStrain;
       if (nd->nleaf > 0 && nd->nleaf < taxSize)
         lab << "/" << taxSize;
@@ -589,9 +636,9 @@ void getDivision(const Taxa &aTaxa, const string &str, map<string, TaxonState> &
   }
 
   if (theRank != 0) {
-    for (auto &tax : aTaxa.def.state) {
-      if (nRanks(tax.first) == theRank)
-        division.insert(tax);
+    for (size_t i = 0; i < aTaxa.def.taxa.size(); ++i) {
+      if (nRanks(aTaxa.def.name(i)) == theRank)
+        division.emplace(aTaxa.def.name(i), aTaxa.def.state[i]);
     }
   } else {
     theInfo("Use the top division rank level");
@@ -601,8 +648,9 @@ void getDivision(const Taxa &aTaxa, const string &str, map<string, TaxonState> &
 
 void getTopDivision(const Taxa &aTaxa, map<string, TaxonState> &division) {
   vector<map<string, TaxonState>> rankset(aTaxa.rank->outrank.size() + 1);
-  for (auto &tax : aTaxa.def.state) {
-    rankset[nRanks(tax.first)].insert(tax);
+  for (size_t i = 0; i < aTaxa.def.taxa.size(); ++i) {
+    rankset[nRanks(aTaxa.def.name(i))].emplace(aTaxa.def.name(i),
+                                                aTaxa.def.state[i]);
   }
 
   for (auto &rk : rankset) {
@@ -634,7 +682,7 @@ string itolPopusStr(Node *nd, const Taxa &aTaxa) {
   stringstream buf;
 
   buf << "<div class='tPop'>"
-      << "<h1>" << lastNameNoRank(nd->name) << "</h1>"
+      << "<h1>" << lastNameNoRankView(nd->getName()) << "</h1>"
       << "<h2>Branch length: " << nd->length << "</h2>"
       << "<h2>" << nd->nleaf;
   if (nd->nxleaf > 0)
@@ -642,9 +690,9 @@ string itolPopusStr(Node *nd, const Taxa &aTaxa) {
   buf << " Leaves</h2>"
       << "<br><h1>Lineage Information: </h1>";
 
-  string lngstr = nd->name;
+  string lngstr = nd->getName();
   lngstr.erase(remove(lngstr.begin(), lngstr.end(), '|'), lngstr.end());
-  vector<string> nmlist;
+  vector<string_view> nmlist;
   parseLineage(lngstr, nmlist);
   size_t nOutput = nmlist.size() < aTaxa.rank->outrank.size()
                        ? nmlist.size()
@@ -654,11 +702,11 @@ string itolPopusStr(Node *nd, const Taxa &aTaxa) {
   for (size_t i = 0; i < nOutput; ++i) {
     buf << "<tr>"
         << "<th>" << aTaxa.rank->outrank[i].first << ": </th>"
-        << "<td>" << lastNameNoRank(nmlist[i]) << "{";
+        << "<td>" << lastNameNoRankView(nmlist[i]) << "{";
 
-    auto iter = aTaxa.def.state.find(nmlist[i]);
-    if (iter != aTaxa.def.state.end())
-      buf << iter->second.nStrain << ", " << iter->second.distract.size();
+    auto st = aTaxa.def.find(nmlist[i]);
+    if (st != NULL)
+      buf << st->nStrain << ", " << st->distract.size();
     else
       buf << "-, -";
     buf << "}</td></tr>";
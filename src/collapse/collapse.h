@@ -35,7 +35,7 @@ struct RunArgs {
   string rootMeth;
   string otuLevel;
   bool forWeb, forApp, predict;
-  bool itol, byBranch;
+  bool itol, byBranch, gzip, binary;
   // two hidden options for output for server and app
 
   RunArgs(int, char **);
@@ -43,6 +43,9 @@ struct RunArgs {
 };
 
 void collapse(int, char **);
+Node *rootingByInput(Node *, bool, const string &, const string &);
+Node *rootingByLineage(Node *, const string &, const string &,
+                       const TaxaRank &);
 
 void output(const LngData &, Taxa &, Node *, RunArgs &);
 void out4serv(const LngData &, Taxa &, Node *, RunArgs &);
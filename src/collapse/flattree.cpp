@@ -0,0 +1,790 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of
+ * Sciences. See the accompanying Manual for the contributors and the way to
+ * cite this work. Comments and suggestions welcome. Please contact Dr.
+ * Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 09:30:12
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 23:48:19
+ */
+
+#include "flattree.h"
+#include "pairsum.h"
+const size_t FlatTree::NONE(numeric_limits<size_t>::max());
+
+FlatTree::FlatTree(Node *root, const function<bool(Node *)> &expand) {
+  // depth first without recursion, children are pushed in reverse order
+  vector<size_t> lastChild;
+  vector<pair<Node *, size_t>> stack{{root, NONE}};
+  while (!stack.empty()) {
+    Node *nd = stack.back().first;
+    size_t p = stack.back().second;
+    stack.pop_back();
+
+    size_t i = nodes.size();
+    nodes.emplace_back(nd);
+    parent.emplace_back(p);
+    firstChild.emplace_back(NONE);
+    nextSibling.emplace_back(NONE);
+    lastChild.emplace_back(NONE);
+    if (p != NONE) {
+      if (firstChild[p] == NONE)
+        firstChild[p] = i;
+      else
+        nextSibling[lastChild[p]] = i;
+      lastChild[p] = i;
+    }
+
+    leaf.emplace_back(nd->isLeaf());
+    expanded.emplace_back(p == NONE || !expand || expand(nd));
+    length.emplace_back(nd->length);
+    depth.emplace_back(nd->depth);
+    varsum.emplace_back(nd->varsum);
+    nleaf.emplace_back(nd->nleaf);
+    nxleaf.emplace_back(nd->nxleaf);
+    taxLevel.emplace_back(nd->taxLevel);
+    unclassified.emplace_back(nd->unclassified);
+
+    if (expanded[i]) {
+      for (auto iter = nd->children.rbegin(); iter != nd->children.rend();
+           ++iter)
+        stack.emplace_back(*iter, i);
+    }
+  }
+};
+
+void FlatTree::getDepth() {
+  for (size_t i = size(); i-- > 0;) {
+    if (!expanded[i])
+      continue;
+
+    double d = 0;
+    if (!leaf[i]) {
+      size_t n = 0;
+      for (size_t c = firstChild[i]; c != NONE; c = nextSibling[c]) {
+        if (leaf[c]) {
+          depth[c] = 0;
+          d += length[c];
+          n++;
+        } else {
+          n += nleaf[c];
+          d += ((length[c] + depth[c]) * nleaf[c]);
+        }
+      }
+      d /= double(n);
+      nleaf[i] = n;
+    }
+    depth[i] = d;
+  }
+
+  // the number of all leafs replaces that of the classified leafs, and the
+  // lineages of the changed nodes are to be renewed
+  for (size_t i = 0; i < size(); ++i) {
+    nodes[i]->depth = depth[i];
+    if (nodes[i]->nleaf != nleaf[i]) {
+      nodes[i]->nleaf = nleaf[i];
+      nodes[i]->_setDirty();
+    }
+  }
+};
+
+void FlatTree::getVarSum() {
+  for (size_t i = size(); i-- > 0;) {
+    if (!expanded[i])
+      continue;
+
+    double v = 0;
+    for (size_t c = firstChild[i]; c != NONE; c = nextSibling[c]) {
+      double delta = depth[i] - depth[c] - length[c];
+      v += varsum[c];
+      v += nleaf[c] * delta * delta;
+    }
+    varsum[i] = v;
+  }
+
+  for (size_t i = 0; i < size(); ++i)
+    nodes[i]->varsum = varsum[i];
+};
+
+void FlatTree::checkUnclassified() {
+  for (size_t i = size(); i-- > 0;) {
+    if (leaf[i]) {
+      nleaf[i] = unclassified[i] ? 0 : 1;
+      nxleaf[i] = unclassified[i] ? 1 : 0;
+    } else {
+      nleaf[i] = 0;
+      nxleaf[i] = 0;
+      for (size_t c = firstChild[i]; c != NONE; c = nextSibling[c]) {
+        nxleaf[i] += nxleaf[c];
+        nleaf[i] += nleaf[c];
+      }
+    }
+
+    if (nleaf[i] == 0)
+      unclassified[i] = true;
+  }
+
+  for (size_t i = 0; i < size(); ++i) {
+    nodes[i]->nleaf = nleaf[i];
+    nodes[i]->nxleaf = nxleaf[i];
+    nodes[i]->unclassified = unclassified[i];
+  }
+};
+
+/********************************************************************************
+ * @brief the otus of the flat tree: the terminals and the leafs in preorder,
+ * so the otus of a subtree are in a range. The heights of nodes are the
+ * distances from the root, and those of otus are added with their depths.
+ ********************************************************************************/
+void FlatTree::getOTUs() {
+  if (otu.size() == size())
+    return;
+
+  otu.assign(size(), false);
+  otuLo.assign(size(), 0);
+  otuHi.assign(size(), 0);
+  height.assign(size(), 0);
+  otuHeight.clear();
+  for (size_t i = 0; i < size(); ++i) {
+    otu[i] = !expanded[i] || leaf[i];
+    if (parent[i] != NONE)
+      height[i] = height[parent[i]] + length[i];
+    otuLo[i] = otuHeight.size();
+    if (otu[i])
+      otuHeight.emplace_back(height[i] + depth[i]);
+  }
+  for (size_t i = size(); i-- > 0;) {
+    otuHi[i] = otu[i] ? otuLo[i] + 1 : otuLo[i];
+    for (size_t c = firstChild[i]; c != NONE; c = nextSibling[c])
+      otuHi[i] = otuHi[c];
+  }
+};
+
+/********************************************************************************
+ * @brief the distances from a node to all otus, the otus of the other side
+ * of an ancestor are measured through their lowest common one.
+ *
+ * @param v the node
+ * @param dist the distances, the otu k is put at (k - start) mod the number
+ * of otus, so the otus from start are in the front
+ * @param start the first otu in the output
+ ********************************************************************************/
+void FlatTree::getOTUDist(size_t v, vector<double> &dist, size_t start) const {
+  size_t nOTU = otuHeight.size();
+  dist.resize(nOTU);
+  auto at = [&](size_t a) { return a < start ? a + nOTU - start : a - start; };
+  for (size_t a = otuLo[v]; a < otuHi[v]; ++a)
+    dist[at(a)] = otuHeight[a] - height[v];
+  for (size_t w = v, u = parent[v]; u != NONE; w = u, u = parent[u]) {
+    double off = height[v] - 2 * height[u];
+    for (size_t a = otuLo[u]; a < otuLo[w]; ++a)
+      dist[at(a)] = otuHeight[a] + off;
+    for (size_t a = otuHi[w]; a < otuHi[u]; ++a)
+      dist[at(a)] = otuHeight[a] + off;
+  }
+};
+
+size_t FlatTree::rootSibling(size_t i) const {
+  size_t front = firstChild[0];
+  size_t back = front == NONE ? NONE : nextSibling[front];
+  if (back == NONE || nextSibling[back] != NONE)
+    return NONE;
+  return i == front ? back : i == back ? front : NONE;
+};
+
+/********************************************************************************
+ * @brief the ancestor deviations of rooting at every branch in one pass.
+ *
+ * By a root on a branch, the pairs of otus across it are divided at the
+ * root, and the others at the vertex where their path meets the way to the
+ * root. So the pairs between two sides of a vertex are shared by all the
+ * branches behind the third side, and the pairs across a branch are those
+ * between the sides of its upper vertex. Each vertex sums the pairs of its
+ * sides once by the distances to all otus, and the sums of a branch are
+ * gathered by a forward sweep. The branch of root is kept by both children
+ * of root, and it is seen from the other child.
+ *
+ * @param mad the split (doi) and the ancestor deviation for the branch above
+ * each node, the same as rearranging the tree with the node as outgroup
+ ********************************************************************************/
+void FlatTree::getMAD(vector<pair<double, double>> &mad) {
+  getOTUs();
+  size_t nOTU = otuHeight.size();
+
+  // the points to sum pairs: the vertices and the children of root
+  vector<size_t> points;
+  for (size_t i = 1; i < size(); ++i) {
+    if (!otu[i] || parent[i] == 0)
+      points.emplace_back(i);
+  }
+  const vector<size_t> &lo = otuLo, &hi = otuHi;
+
+  // the sums over the pairs of the sides without (up) and with the branch
+  vector<double> upSum(size(), 0), downSum(size(), 0);
+  vector<PairSum> cross(size());
+#pragma omp parallel if (nOTU > 1024)
+  {
+    vector<double> dist(nOTU);
+    vector<pair<size_t, size_t>> sides;
+    vector<PairSum> sums, side;
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t k = 0; k < points.size(); ++k) {
+      size_t v = points[k];
+
+      // the distances to otus in the order from the subtree of v
+      getOTUDist(v, dist, lo[v]);
+
+      // the sides of point: the children (or itself for an otu) and the up
+      sides.clear();
+      if (otu[v]) {
+        sides.emplace_back(0, hi[v] - lo[v]);
+      } else {
+        for (size_t c = firstChild[v]; c != NONE; c = nextSibling[c])
+          sides.emplace_back(lo[c] - lo[v], hi[c] - lo[v]);
+      }
+      sides.emplace_back(hi[v] - lo[v], nOTU);
+
+      // the pairs between each two sides
+      size_t n = sides.size();
+      sums.assign(n * n, PairSum());
+      for (size_t r = 0; r < n; ++r) {
+        for (size_t q = r + 1; q < n; ++q) {
+          PairSum &s = sums[r * n + q];
+          sumPairs(dist.data() + sides[r].first,
+                   sides[r].second - sides[r].first,
+                   dist.data() + sides[q].first,
+                   sides[q].second - sides[q].first, s);
+          sums[q * n + r] = s.flip();
+        }
+      }
+
+      // the pairs across a branch and those by the other sides of vertex
+      double total(0);
+      side.assign(n, PairSum());
+      for (size_t r = 0; r < n; ++r) {
+        for (size_t q = 0; q < n; ++q) {
+          if (q != r)
+            side[r] += sums[r * n + q];
+        }
+        total += side[r].rd;
+      }
+      total *= 0.5;
+
+      if (!otu[v]) {
+        size_t r = 0;
+        for (size_t c = firstChild[v]; c != NONE; c = nextSibling[c], ++r) {
+          cross[c] = side[r];
+          downSum[c] = total - side[r].rd;
+        }
+        upSum[v] = total - side[n - 1].rd;
+      }
+      if (parent[v] == 0 && rootSibling(v) != NONE)
+        cross[rootSibling(v)] = side[n - 1];
+    }
+  }
+
+  // the pairs by vertices are shared by the branches behind them
+  double upTotal(0);
+  for (size_t i = 1; i < size(); ++i)
+    upTotal += upSum[i];
+  vector<double> inner(size(), 0);
+  for (size_t i = 1; i < size(); ++i) {
+    if (parent[i] != 0)
+      inner[i] = inner[parent[i]] + downSum[i] - upSum[parent[i]];
+  }
+
+  // the split at the branch and the ancestor deviation
+  mad.assign(size(), make_pair(0.0, numeric_limits<double>::quiet_NaN()));
+  for (size_t i = 1; i < size(); ++i) {
+    const PairSum &s = cross[i];
+    double len = length[i];
+    if (parent[i] == 0 && rootSibling(i) != NONE)
+      len += length[rootSibling(i)];
+
+    // the deviation is taken at the split where the root is placed
+    double doi = s.wd * 0.5 / s.w;
+    if (doi < 0)
+      doi = 0;
+    else if (doi > len)
+      doi = len;
+    double doi2 = doi * 2;
+
+    mad[i].first = doi;
+    if (s.nzero == 0)
+      mad[i].second = upTotal + inner[i] + s.rx - 2 * doi2 * s.wd +
+                      doi2 * doi2 * s.w;
+  }
+};
+
+/********************************************************************************
+ * @brief the keys of otus in a treap ordered by values, each otu is a node
+ * with at most one key, so the keys in a range are counted by the ranks.
+ * The ties of keys are ordered by the otus, and the priorities are fixed by
+ * a hash of the otus, so the treap is the same for the same keys.
+ ********************************************************************************/
+struct KeyTreap {
+  vector<double> key;
+  vector<size_t> left, right, count;
+  vector<uint64_t> prior;
+  size_t root;
+
+  KeyTreap(size_t n)
+      : key(n), left(n, FlatTree::NONE), right(n, FlatTree::NONE),
+        count(n, 0), prior(n), root(FlatTree::NONE) {
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t z = (i + 1) * 0x9E3779B97F4A7C15ULL;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      prior[i] = z ^ (z >> 31);
+    }
+  };
+
+  size_t size(size_t t) const { return t == FlatTree::NONE ? 0 : count[t]; };
+  void pull(size_t t) { count[t] = 1 + size(left[t]) + size(right[t]); };
+  bool before(size_t i, size_t j) const {
+    return key[i] < key[j] || (key[i] == key[j] && i < j);
+  };
+
+  // split a treap to the nodes before i and the others
+  void split(size_t t, size_t i, size_t &lo, size_t &hi) {
+    if (t == FlatTree::NONE) {
+      lo = hi = FlatTree::NONE;
+    } else if (before(t, i)) {
+      split(right[t], i, right[t], hi);
+      lo = t;
+      pull(t);
+    } else {
+      split(left[t], i, lo, left[t]);
+      hi = t;
+      pull(t);
+    }
+  };
+
+  size_t merge(size_t lo, size_t hi) {
+    if (lo == FlatTree::NONE || hi == FlatTree::NONE)
+      return lo == FlatTree::NONE ? hi : lo;
+    if (prior[lo] > prior[hi]) {
+      right[lo] = merge(right[lo], hi);
+      pull(lo);
+      return lo;
+    }
+    left[hi] = merge(lo, left[hi]);
+    pull(hi);
+    return hi;
+  };
+
+  size_t erase(size_t t, size_t i) {
+    if (t == i)
+      return merge(left[t], right[t]);
+    if (before(i, t))
+      left[t] = erase(left[t], i);
+    else
+      right[t] = erase(right[t], i);
+    pull(t);
+    return t;
+  };
+
+  void insert(size_t i, double k) {
+    key[i] = k;
+    left[i] = right[i] = FlatTree::NONE;
+    count[i] = 1;
+    size_t lo, hi;
+    split(root, i, lo, hi);
+    root = merge(merge(lo, i), hi);
+  };
+
+  void erase(size_t i) { root = erase(root, i); };
+
+  // the number of keys less than k, or not larger than k
+  size_t rank(double k, bool equal = false) const {
+    size_t n = 0;
+    for (size_t t = root; t != FlatTree::NONE;) {
+      if (key[t] < k || (equal && key[t] == k)) {
+        n += size(left[t]) + 1;
+        t = right[t];
+      } else {
+        t = left[t];
+      }
+    }
+    return n;
+  };
+};
+
+/********************************************************************************
+ * @brief the fractions of the pairs of otus across each branch with the
+ * midpoint of their path on the branch, for all branches in one pass.
+ *
+ * For a branch from vertex p to its child x, an otu i below and an otu o
+ * above has the midpoint on the branch when the distance from p to o is in
+ * (d(p,i) - 2L, d(p,i)). With the key of o at p as d(p,o) - h(p), that is
+ * t(o) - 2h(u) by the height t of otu and the lowest common ancestor u of o
+ * and p, the condition turns to the key in (t(i) - 2h(x), t(i) - 2h(p)). So
+ * each otu keeps one key in a treap ordered by values, and a depth first
+ * pass changes only the keys of the subtree when it goes into a vertex, then
+ * counts the pairs of each otu by two queries. The memory is linear in the
+ * number of otus, and the time is by the sum of the otus of all subtrees with
+ * a log factor, which is quadratic for a caterpillar tree. The branch of root
+ * is seen from the other child of root.
+ *
+ * The pass is split by the subtrees of middle size for the threads, each
+ * starts from the keys at its top vertex and stops at the others. The
+ * counts are the same by any split.
+ *
+ * @param pmr the fraction for the branch above each node, the same as
+ * rearranging the tree with the node as outgroup
+ ********************************************************************************/
+void FlatTree::getPMR(vector<double> &pmr) {
+  getOTUs();
+  size_t nOTU = otuHeight.size();
+
+  // the nodes of a subtree are from it to the end
+  vector<size_t> nodeEnd(size());
+  for (size_t i = size(); i-- > 0;) {
+    nodeEnd[i] = i + 1;
+    for (size_t c = firstChild[i]; c != NONE; c = nextSibling[c])
+      nodeEnd[i] = nodeEnd[c];
+  }
+
+  // the top vertices of the parts: the root and the subtrees below a large
+  // one with a size of about the otus per thread
+  vector<char> top(size(), false);
+  vector<size_t> tops{0};
+  top[0] = true;
+  if (nThreads() > 1) {
+    size_t grain = nOTU / nThreads() + 1;
+    for (size_t i = 1; i < size(); ++i) {
+      size_t n = otuHi[i] - otuLo[i];
+      size_t np = otuHi[parent[i]] - otuLo[parent[i]];
+      if (!otu[i] && n <= grain && n * 4 >= grain && np > grain) {
+        top[i] = true;
+        tops.emplace_back(i);
+      }
+    }
+  }
+
+  pmr.assign(size(), 0);
+#pragma omp parallel for schedule(dynamic, 1) if (tops.size() > 1)
+  for (size_t k = 0; k < tops.size(); ++k)
+    _countPMR(tops[k], top, nodeEnd, pmr);
+};
+
+/********************************************************************************
+ * @brief the pairwise midpoints of the branches in a subtree, see getPMR
+ *
+ * @param w the top vertex of the subtree
+ * @param top the top vertices of the other parts, they are not gone into
+ * @param nodeEnd the end of nodes in each subtree
+ * @param pmr the fraction for the branch above each node
+ ********************************************************************************/
+void FlatTree::_countPMR(size_t w, const vector<char> &top,
+                         const vector<size_t> &nodeEnd,
+                         vector<double> &pmr) const {
+  size_t nOTU = otuHeight.size();
+
+  // the keys of otus: the ones outside by the common ancestors with w, and
+  // the ones inside by w
+  auto key = [&](size_t a, size_t v) { return otuHeight[a] - 2 * height[v]; };
+  KeyTreap keys(nOTU);
+  for (size_t v = w, u = parent[w]; u != NONE; v = u, u = parent[u]) {
+    for (size_t a = otuLo[u]; a < otuLo[v]; ++a)
+      keys.insert(a, key(a, u));
+    for (size_t a = otuHi[v]; a < otuHi[u]; ++a)
+      keys.insert(a, key(a, u));
+  }
+  for (size_t a = otuLo[w]; a < otuHi[w]; ++a)
+    keys.insert(a, key(a, w));
+  auto shift = [&](size_t v, size_t to) {
+    for (size_t a = otuLo[v]; a < otuHi[v]; ++a) {
+      keys.erase(a);
+      keys.insert(a, key(a, to));
+    }
+  };
+
+  vector<size_t> path{w};
+  for (size_t x = w + 1; x < nodeEnd[w]; ++x) {
+    size_t p = parent[x];
+    while (path.back() != p) {
+      size_t v = path.back();
+      path.pop_back();
+      shift(v, path.back());
+    }
+
+    // the height of upper end, the other child for the branch of root
+    double hp = height[p];
+    if (p == 0 && rootSibling(x) != NONE)
+      hp = -length[rootSibling(x)];
+
+    // the otus below are taken off, and the others are counted by keys
+    for (size_t a = otuLo[x]; a < otuHi[x]; ++a)
+      keys.erase(a);
+    size_t n = 0;
+    for (size_t a = otuLo[x]; a < otuHi[x]; ++a) {
+      double up = otuHeight[a] - 2 * hp;
+      double down = key(a, x);
+      if (down < up)
+        n += keys.rank(up) - keys.rank(down, true);
+    }
+    size_t nBack = otuHi[x] - otuLo[x];
+    if (n > 0)
+      pmr[x] = double(n) / ((nOTU - nBack) * nBack);
+
+    // go into the vertex by the keys of its subtree, or skip it
+    bool into = !otu[x] && !top[x];
+    for (size_t a = otuLo[x]; a < otuHi[x]; ++a)
+      keys.insert(a, into ? key(a, x) : key(a, p));
+    if (into)
+      path.emplace_back(x);
+    else
+      x = nodeEnd[x] - 1;
+  }
+};
+
+/********************************************************************************
+ * @brief the split of the branch above a node by the mean of the midpoints
+ * on it. The distances from the upper end to the otus of two sides are
+ * sorted, and the midpoints of each otu below are summed by two pointers on
+ * the prefix sums of the otus above.
+ *
+ * @param x the node below the branch
+ * @return the distance from the otus above to the split, measured from
+ * the upper end of branch
+ ********************************************************************************/
+double FlatTree::getPMRSplit(size_t x) {
+  getOTUs();
+
+  // the upper end, the other child for the branch of root
+  size_t p = parent[x];
+  double len = length[x];
+  if (p == 0 && rootSibling(x) != NONE) {
+    p = rootSibling(x);
+    len += length[p];
+  }
+
+  vector<double> dist, front, back;
+  getOTUDist(p, dist);
+  for (size_t a = 0; a < dist.size(); ++a) {
+    if (a >= otuLo[x] && a < otuHi[x])
+      back.emplace_back(dist[a]);
+    else
+      front.emplace_back(dist[a]);
+  }
+  sort(front.begin(), front.end());
+  sort(back.begin(), back.end());
+  vector<double> sum(front.size() + 1, 0);
+  for (size_t j = 0; j < front.size(); ++j)
+    sum[j + 1] = sum[j] + front[j];
+
+  // the otus above in (d - 2L, d) for the otu below by the distance d
+  double dio = 0;
+  size_t n = 0, lo = 0, hi = 0;
+  for (auto d : back) {
+    while (lo < front.size() && 0.5 * (d - front[lo]) >= len)
+      ++lo;
+    while (hi < front.size() && 0.5 * (d - front[hi]) > 0)
+      ++hi;
+    if (hi > lo) {
+      n += hi - lo;
+      dio += 0.5 * ((hi - lo) * d - (sum[hi] - sum[lo]));
+    }
+  }
+  return n == 0 ? 0 : dio / n;
+};
+
+/********************************************************************************
+ * @brief the midpoint of the longest path between two otus. A backward sweep
+ * gets the deepest otu below each node, and the longest path turns at the
+ * vertex with the largest sum of its two deepest children, all children of
+ * a multifurcating vertex are seen. The midpoint is on the side of the
+ * deeper child, so it is found by going up from the otu of that side.
+ *
+ * @param node the node below the branch with the midpoint, NONE for the
+ * tree without two otus
+ * @param split the distance from the node to the midpoint
+ * @return the length of the longest path
+ ********************************************************************************/
+double FlatTree::getMidpoint(size_t &node, double &split) {
+  getOTUs();
+
+  vector<double> down(size(), 0);
+  vector<size_t> deepest(size(), NONE);
+  double maxPath(-1);
+  size_t turn(NONE), from(NONE);
+  for (size_t i = size(); i-- > 0;) {
+    if (otu[i]) {
+      down[i] = depth[i];
+      deepest[i] = i;
+      continue;
+    }
+
+    // the two deepest children
+    double first(-1), second(-1);
+    size_t deep(NONE);
+    for (size_t c = firstChild[i]; c != NONE; c = nextSibling[c]) {
+      double d = length[c] + down[c];
+      if (d > first) {
+        second = first;
+        first = d;
+        deep = c;
+      } else if (d > second) {
+        second = d;
+      }
+    }
+    if (deep == NONE)
+      continue;
+    down[i] = first;
+    deepest[i] = deepest[deep];
+    if (second >= 0 && first + second > maxPath) {
+      maxPath = first + second;
+      turn = i;
+      from = deepest[deep];
+    }
+  }
+
+  node = NONE;
+  split = 0;
+  if (turn == NONE)
+    return 0;
+
+  // go up from the deeper otu until the branch over the half
+  double half = 0.5 * maxPath;
+  double dist = depth[from];
+  node = from;
+  while (parent[node] != turn && dist + length[node] < half) {
+    dist += length[node];
+    node = parent[node];
+  }
+  split = max(0.0, min(length[node], half - dist));
+  return maxPath;
+};
+
+/********************************************************************************
+ * @brief a child of a vertex seen from a branch: the length to it, the mean
+ * depth, the variation sum and the number of leafs below it
+ ********************************************************************************/
+struct DepthSum {
+  double len, depth, varsum;
+  size_t nleaf;
+  bool leaf;
+};
+
+// the mean depth of a vertex by its children, the same as Node::_getDepth
+static double meanDepth(const vector<DepthSum> &sides, size_t &n) {
+  double d = 0;
+  n = 0;
+  for (auto &s : sides) {
+    if (s.leaf) {
+      d += s.len;
+      n++;
+    } else {
+      n += s.nleaf;
+      d += ((s.len + s.depth) * s.nleaf);
+    }
+  }
+  return d / double(n);
+};
+
+// the variation sum of a vertex by its children, the same as
+// Node::_getVarSum
+static double varSum(const vector<DepthSum> &sides, double depth) {
+  double v = 0;
+  for (auto &s : sides) {
+    double delta = depth - s.depth - s.len;
+    v += s.varsum;
+    v += s.nleaf * delta * delta;
+  }
+  return v;
+};
+
+// the root between two sides at the midpoint of their mean depths, the same
+// as Node::_setLengthByMidpoint
+static MidRoot midRoot(DepthSum front, DepthSum back) {
+  DepthSum *deep = &front;
+  DepthSum *shallow = &back;
+  if (deep->depth < shallow->depth)
+    swap(deep, shallow);
+
+  double lengthTotal = deep->len + shallow->len;
+  deep->len = 0.5 * (shallow->depth + lengthTotal - deep->depth);
+  if (deep->len < 0) {
+    deep->len = 0;
+    shallow->len = lengthTotal;
+  } else {
+    shallow->len = lengthTotal - deep->len;
+  }
+
+  vector<DepthSum> sides{front, back};
+  MidRoot mid;
+  size_t n;
+  mid.depth = meanDepth(sides, n);
+  mid.varsum = varSum(sides, mid.depth);
+  mid.inner = front.len > 0 && back.len > 0;
+  return mid;
+};
+
+/********************************************************************************
+ * @brief the midpoint roots on all branches by two passes.
+ *
+ * The mean depths and variation sums below nodes are ready by the nodes (the
+ * down pass). By a root on the branch above a node, the other side is its
+ * parent seen without it: the siblings and the part above the parent, which
+ * is from the grandparent in the same way. So a forward sweep gets the other
+ * sides of all branches (the up pass), and the root on each branch is set
+ * by the midpoint of two sides. The branch of root joins two children of
+ * root, the same as rearranging the tree with the node as outgroup. The time
+ * is linear for the trees of bounded degree.
+ *
+ * @param mid the midpoint root on the branch above each node
+ ********************************************************************************/
+void FlatTree::getMidRoots(vector<MidRoot> &mid) {
+  auto down = [&](size_t i) {
+    return DepthSum{length[i], depth[i], varsum[i], nleaf[i], bool(leaf[i])};
+  };
+
+  // the parent seen from each node without it
+  vector<DepthSum> up(size());
+  vector<DepthSum> sides;
+  mid.assign(size(), MidRoot{numeric_limits<double>::quiet_NaN(),
+                             numeric_limits<double>::quiet_NaN(), false});
+  for (size_t p = 0; p < size(); ++p) {
+    if (!expanded[p] || leaf[p])
+      continue;
+
+    for (size_t x = firstChild[p]; x != NONE; x = nextSibling[x]) {
+      DepthSum back = down(x);
+
+      // the branch of root is from the other child of root
+      if (p == 0 && rootSibling(x) != NONE) {
+        DepthSum front = down(rootSibling(x));
+        back.len += front.len;
+        front.len = 0;
+        mid[x] = midRoot(front, back);
+        continue;
+      }
+
+      // the siblings and the part above the parent
+      sides.clear();
+      for (size_t c = firstChild[p]; c != NONE; c = nextSibling[c]) {
+        if (c != x)
+          sides.emplace_back(down(c));
+      }
+      if (p != 0) {
+        if (parent[p] == 0 && rootSibling(p) != NONE) {
+          sides.emplace_back(down(rootSibling(p)));
+        } else {
+          sides.emplace_back(up[p]);
+        }
+        sides.back().len += length[p];
+      }
+
+      DepthSum &front = up[x];
+      front.len = 0;
+      front.leaf = false;
+      front.depth = meanDepth(sides, front.nleaf);
+      front.varsum = varSum(sides, front.depth);
+      mid[x] = midRoot(front, back);
+    }
+  }
+};
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of
+ * Sciences. See the accompanying Manual for the contributors and the way to
+ * cite this work. Comments and suggestions welcome. Please contact Dr.
+ * Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 09:30:12
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 23:48:19
+ */
+
+#ifndef FLATTREE_H
+#define FLATTREE_H
+
+#include <functional>
+#include <vector>
+
+#include "taxtree.h"
+using namespace std;
+
+// the root at the midpoint of mean depths on a branch: the mean depth and
+// the variation sum of leafs, and whether both root branches are not zero
+struct MidRoot {
+  double depth, varsum;
+  bool inner;
+};
+
+/********************************************************************************
+ * @brief the flat tree: nodes in preorder with the index of parent, first
+ * child and next sibling, and the hot fields of nodes in arrays. A node is
+ * always before its descendants, so a backward sweep is a postorder pass.
+ *
+ * Only the nodes accepted by the expand function (and the root) are
+ * expanded with their children, the others are kept as terminals with
+ * their current values.
+ ********************************************************************************/
+struct FlatTree {
+  static const size_t NONE;
+
+  vector<Node *> nodes;
+  vector<size_t> parent, firstChild, nextSibling;
+  vector<char> leaf, expanded;
+  vector<double> length, depth, varsum;
+  vector<size_t> nleaf, nxleaf, taxLevel;
+  vector<char> unclassified;
+
+  // the otus in preorder: the range of them in each subtree, the distances
+  // from root to nodes (height) and to otus, set by getOTUs
+  vector<char> otu;
+  vector<size_t> otuLo, otuHi;
+  vector<double> height, otuHeight;
+
+  FlatTree(Node *, const function<bool(Node *)> &expand = nullptr);
+  size_t size() const { return nodes.size(); };
+
+  // the passes from leafs to root, the results are saved back to nodes
+  void getDepth();
+  void getVarSum();
+  void checkUnclassified();
+
+  // the split and ancestor deviation of rooting at the branch above each
+  // node, the terminals are the otus
+  void getMAD(vector<pair<double, double>> &);
+
+  // the midpoint roots on the branch above each node, the terminals are
+  // the otus
+  void getMidRoots(vector<MidRoot> &);
+
+  // the fraction of pairs with the midpoint on the branch above each node,
+  // and the mean split by these pairs for a branch
+  void getPMR(vector<double> &);
+  void _countPMR(size_t, const vector<char> &, const vector<size_t> &,
+                 vector<double> &) const;
+  double getPMRSplit(size_t);
+
+  // the midpoint of the longest path between otus, by the node below its
+  // branch and the distance from the node
+  double getMidpoint(size_t &, double &);
+
+  // the otus and the distances from a node to them
+  void getOTUs();
+  void getOTUDist(size_t, vector<double> &, size_t start = 0) const;
+  size_t rootSibling(size_t) const;
+};
+
+#endif
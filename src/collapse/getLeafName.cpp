@@ -46,13 +46,28 @@ void getLeafName(int argc, char *argv[]) {
 }
 
 void getAllLeaf(const string &intree, vector<string> &namelist) {
-  Node *aTree = new Node;
-  aTree->innwk(intree);
+  MapFile tree(intree);
+  if (!tree.good()) {
+    cerr << "Cannot found the input tree file " << intree << endl;
+    exit(4);
+  }
+
+  NodePool pool;
+  Node *aTree = pool.newNode();
+  bool binary = isBinTree(tree.begin(), tree.end());
+  if (binary)
+    aTree->inbin(tree.begin(), tree.end());
+  else
+    aTree->innwk(tree.begin(), tree.end(), true);
   vector<Node *> allLeafs;
   aTree->getLeafs(allLeafs);
 
+  // the leaf of binary tree keeps the whole lineage, and the name is the
+  // part after '|' as the label in the annotated newick file
   for (auto &nd : allLeafs) {
-    namelist.emplace_back(nd->name);
+    string nm(nd->getName());
+    size_t pos = binary ? nm.find_first_of('|') : string::npos;
+    namelist.emplace_back(pos == string::npos ? nm : nm.substr(pos + 1));
   }
 }
 
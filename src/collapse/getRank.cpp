@@ -38,11 +38,11 @@ void getRank(int argc, char *argv[]) {
   }
 
   // get the rank abbreviation map
-  TaxaRank *rank = TaxaRank::create();
+  TaxaRank rank;
   ofstream ofs(outfile);
 
   if (allrank) {
-    for (auto &rk : rank->rankmap) {
+    for (auto &rk : rank.rankmap) {
       ofs << rk.first << "\t" << rk.second << endl;
     }
   } else {
@@ -53,8 +53,8 @@ void getRank(int argc, char *argv[]) {
     for (auto nm : ranklist) {
       for (auto pf : prefix) {
         string name = pf + nm;
-        auto iter = rank->rankmap.find(name);
-        if (iter != rank->rankmap.end()) {
+        auto iter = rank.rankmap.find(name);
+        if (iter != rank.rankmap.end()) {
           ofs << iter->first << "\t" << iter->second << endl;
         }
       }
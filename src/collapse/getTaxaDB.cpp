@@ -43,7 +43,8 @@ void mkTaxaDB(int argc, char *argv[]) {
   }
 
   // Initial the taxadb by the dump files
-  TaxaDB taxdb(dumps);
+  TaxaRank rank;
+  TaxaDB taxdb(dumps, &rank);
 
   // output the gz database if queryfile empty
   if (outdir.empty()) {
@@ -13,10 +13,10 @@
 #include "lineage.h"
 
 ostream &operator<<(ostream &os, const Lineage &lng) {
-  vector<string> ranks;
+  vector<string_view> ranks;
   separateLineage(lng.name, ranks);
   for (auto &str : ranks) {
-    str = lastNameNoRank(str);
+    str = lastNameNoRankView(str);
   }
   os << "[\"";
   os << ranks.back() << "\",\"";
@@ -28,15 +28,16 @@ ostream &operator<<(ostream &os, const Lineage &lng) {
 /********************************************************************************
  * @brief Construct a new Lineage Data:: Lineage Map.
  *        basic option of Lineage
+ * @param rk the rank context of the job, the out ranks may be reset by the
+ *        header of lineage files
  * @param taxfile
  ********************************************************************************/
-LngData::LngData() { rank = rank->create(); };
+LngData::LngData(TaxaRank *rk) : rank(rk){};
 
-LngData::LngData(const string &dbpath, const string &taxfile,
+LngData::LngData(TaxaRank *rk, const string &dbpath, const string &taxfile,
                  const string &revfile)
-    : tdbpath(dbpath), revfile(revfile) {
+    : tdbpath(dbpath), revfile(revfile), rank(rk) {
   separateWord(tflist, taxfile);
-  rank = rank->create();
 };
 
 /********************************************************************************
@@ -46,6 +47,28 @@ LngData::LngData(const string &dbpath, const string &taxfile,
  ********************************************************************************/
 void LngData::getLineage(vector<string> &nmlist) {
 
+  // find the lineages of names in the taxfiles and the database
+  findLineage(nmlist);
+
+  // the revision of lineages
+  Revision rev;
+  if (!revfile.empty())
+    rev = Revision(revfile);
+
+  // format and revise the lineages
+  reviseLineage(rev, true);
+
+  // check Repeat names
+  checkRepeats();
+};
+
+/********************************************************************************
+ * @brief search the raw lineages of names in the taxfiles and the database
+ *
+ * @param nmlist a list of names for query
+ ********************************************************************************/
+void LngData::findLineage(vector<string> &nmlist) {
+
   // initial the data
   for (auto &nm : nmlist) {
     data.emplace_back(nm);
@@ -57,33 +80,30 @@ void LngData::getLineage(vector<string> &nmlist) {
   // find lineage in database
   if (nHit < data.size() && fileExists(tdbpath))
     getLngFromDB();
+};
 
-  // format the lineage and do revsion
-  for (auto &lng : data) {
-    rank->format(lng.name);
-  }
-
-  // do revision
-  if (!revfile.empty()) {
-    Revision rev(revfile);
-    if (!rev.empty()) {
-      int nReplace(0);
-      for (auto &lng : data) {
-        if (rev.revise(lng.name) > 0)
-          ++nReplace;
-      }
-      theInfo("There are " + to_string(nReplace) +
-              " lineage had been changed by revision file");
-    }
-  }
-
-  // check Repeat names
-  checkRepeats();
-
-  // set the unclassified items
-  for (auto &lng : data) {
-    lng.def = rank->wellDefined(lng.name);
+/********************************************************************************
+ * @brief format the lineages by the plan for out ranks, do revision and set
+ * the unclassified items, the lineages are done in parallel by batches
+ *
+ * @param rev the revision, do nothing if empty
+ * @param format format the raw lineages before revision
+ ********************************************************************************/
+void LngData::reviseLineage(const Revision &rev, bool format) {
+  LngFormat plan(*rank);
+  int nReplace(0);
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : nReplace) \
+    if (data.size() > 1024)
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (format)
+      plan.format(data[i].name);
+    if (!rev.empty() && rev.revise(data[i].name) > 0)
+      ++nReplace;
+    data[i].def = rank->wellDefined(data[i].name);
   }
+  if (!rev.empty())
+    theInfo("There are " + to_string(nReplace) +
+            " lineage had been changed by revision file");
 };
 
 // read the lineage string from input taxon file
@@ -130,7 +150,7 @@ size_t LngData::getLngFromFile() {
 
 // get lineage from database file
 void LngData::getLngFromDB() {
-  TaxaDB taxadb(tdbpath);
+  TaxaDB taxadb(tdbpath, rank);
   size_t mHit(0);
   for (auto &lng : data) {
     if (!lng.def) {
@@ -349,11 +369,12 @@ void LngData::outcsv(ostream &os) const {
   os << "Strain(T),";
   rank->outRanksCSV(os);
 
+  vector<string_view> ranks;
   for (auto &lng : data) {
-    vector<string> ranks;
+    ranks.clear();
     separateLineage(lng.name, ranks);
     for (auto &str : ranks) {
-      str = lastNameNoRank(str);
+      str = lastNameNoRankView(str);
     }
     os << "\n" << ranks.back() << ",";
     os << strjoin(ranks.begin(), ranks.end() - 1, ",");
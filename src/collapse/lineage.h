@@ -45,12 +45,14 @@ struct LngData {
   TaxaRank *rank;
 
   /// basic setting options
-  LngData();
-  LngData(const string &, const string &, const string &);
+  explicit LngData(TaxaRank *);
+  LngData(TaxaRank *, const string &, const string &, const string &);
   void initData(const vector<string> &);
 
   // search entry
   void getLineage(vector<string> &);
+  void findLineage(vector<string> &);
+  void reviseLineage(const Revision &, bool);
   size_t getLngFromFile();
 	void getLngFromDB();
   void readListFile(istream &, TaxMap &);
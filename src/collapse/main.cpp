@@ -17,6 +17,8 @@
 #include "getTaxaDB.h"
 #include "queryLineage.h"
 #include "searchLineage.h"
+#include "sweep.h"
+#include "update.h"
 using namespace std;
 
 void usage(string &program) {
@@ -26,6 +28,8 @@ void usage(string &program) {
        << "   run       All-in-one command: search lineage of leavies,\n"
        << "             annotate phylogenetic tree, and do comparation.\n"
        << "   root      rooting a phylogenetic tree.\n"
+       << "   update    Insert or delete leafs of an annotated tree\n"
+       << "   sweep     Compare the entropies of a tree by revision files\n"
        << "   leaf      Obtain species name list of phylogenetic tree\n"
        << "   cache     Make NCBI database cache from taxdump.tar.gz\n"
        << "   rank      Output taxon rank names and abbreviations\n"
@@ -77,6 +81,10 @@ int main(int argc, char *argv[]) {
       collapse(argc, argv);
     } else if(task.compare("root") == 0){
       rooting(argc,argv);
+    } else if (task.compare("update") == 0) {
+      update(argc, argv);
+    } else if (task.compare("sweep") == 0) {
+      sweep(argc, argv);
     } else if (task.compare("query") == 0) {
       queryLineage(argc, argv);
     } else if (task.compare("cache") == 0) {
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of
+ * Sciences. See the accompanying Manual for the contributors and the way to
+ * cite this work. Comments and suggestions welcome. Please contact Dr.
+ * Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 16:05:40
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 23:32:05
+ */
+
+#include "pairsum.h"
+
+// the vector kernels: selected at runtime on x86, NEON is always on arm64
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PAIRSUM_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define PAIRSUM_NEON
+#include <arm_neon.h>
+#endif
+
+void sumPairsScalar(const double *x, size_t nx, const double *y, size_t ny,
+                    PairSum &s) {
+  for (size_t i = 0; i < nx; ++i) {
+    for (size_t j = 0; j < ny; ++j) {
+      double len = x[i] + y[j];
+      if (len == 0) {
+        ++s.nzero;
+        continue;
+      }
+      double d = x[i] - y[j];
+      double w = 1 / (len * len);
+      double r = d * d * w;
+      s.w += w;
+      s.wd += d * w;
+      s.rx += r;
+      if (len > 0)
+        s.rd += r;
+    }
+  }
+};
+
+/********************************************************************************
+ * @brief the vector kernels. Each lane takes a pair the same as the scalar
+ * loop, the pairs of zero length are masked off (and counted), and the
+ * squares are masked for the paths longer than zero. Only the order of the
+ * sums is changed, and the rest of the lanes are by the scalar loop.
+ ********************************************************************************/
+#ifdef PAIRSUM_X86
+__attribute__((target("avx2"))) static double hsum(__m256d v) {
+  __m128d t = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(t, _mm_unpackhi_pd(t, t)));
+};
+
+// the two halves are added before the sum of avx2, the zero-masked
+// extractions avoid the undefined vector of _mm512_reduce_add_pd and
+// _mm512_extractf64x4_pd, which gcc -Wall warns as uninitialized
+__attribute__((target("avx512f"))) static double hsum(__m512d v) {
+  return hsum(_mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xFF, v, 0),
+                            _mm512_maskz_extractf64x4_pd(0xFF, v, 1)));
+};
+
+__attribute__((target("avx512f"))) static void
+sumPairsAVX512(const double *x, size_t nx, const double *y, size_t ny,
+               PairSum &s) {
+  const __m512d zero = _mm512_setzero_pd();
+  const __m512d one = _mm512_set1_pd(1.0);
+  __m512d w = zero, wd = zero, rd = zero, rx = zero, nzero = zero;
+  size_t m = ny - ny % 8;
+  for (size_t i = 0; i < nx; ++i) {
+    __m512d xi = _mm512_set1_pd(x[i]);
+    for (size_t j = 0; j < m; j += 8) {
+      __m512d yj = _mm512_loadu_pd(y + j);
+      __m512d len = _mm512_add_pd(xi, yj);
+      __m512d d = _mm512_sub_pd(xi, yj);
+      __mmask8 nonzero = _mm512_cmp_pd_mask(len, zero, _CMP_NEQ_UQ);
+      __mmask8 positive = _mm512_cmp_pd_mask(len, zero, _CMP_GT_OQ);
+      __m512d wj = _mm512_maskz_div_pd(nonzero, one, _mm512_mul_pd(len, len));
+      __m512d r = _mm512_mul_pd(_mm512_mul_pd(d, d), wj);
+      w = _mm512_add_pd(w, wj);
+      wd = _mm512_add_pd(wd, _mm512_mul_pd(d, wj));
+      rx = _mm512_add_pd(rx, r);
+      rd = _mm512_mask_add_pd(rd, positive, rd, r);
+      nzero = _mm512_mask_add_pd(nzero, __mmask8(~nonzero), nzero, one);
+    }
+    sumPairsScalar(x + i, 1, y + m, ny - m, s);
+  }
+  s.w += hsum(w);
+  s.wd += hsum(wd);
+  s.rd += hsum(rd);
+  s.rx += hsum(rx);
+  s.nzero += size_t(hsum(nzero));
+};
+
+__attribute__((target("avx2"))) static void
+sumPairsAVX2(const double *x, size_t nx, const double *y, size_t ny,
+             PairSum &s) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d one = _mm256_set1_pd(1.0);
+  __m256d w = zero, wd = zero, rd = zero, rx = zero, nzero = zero;
+  size_t m = ny - ny % 4;
+  for (size_t i = 0; i < nx; ++i) {
+    __m256d xi = _mm256_set1_pd(x[i]);
+    for (size_t j = 0; j < m; j += 4) {
+      __m256d yj = _mm256_loadu_pd(y + j);
+      __m256d len = _mm256_add_pd(xi, yj);
+      __m256d d = _mm256_sub_pd(xi, yj);
+      __m256d nonzero = _mm256_cmp_pd(len, zero, _CMP_NEQ_UQ);
+      __m256d positive = _mm256_cmp_pd(len, zero, _CMP_GT_OQ);
+      __m256d wj = _mm256_and_pd(
+          _mm256_div_pd(one, _mm256_mul_pd(len, len)), nonzero);
+      __m256d r = _mm256_mul_pd(_mm256_mul_pd(d, d), wj);
+      w = _mm256_add_pd(w, wj);
+      wd = _mm256_add_pd(wd, _mm256_mul_pd(d, wj));
+      rx = _mm256_add_pd(rx, r);
+      rd = _mm256_add_pd(rd, _mm256_and_pd(r, positive));
+      nzero = _mm256_add_pd(nzero, _mm256_andnot_pd(nonzero, one));
+    }
+    sumPairsScalar(x + i, 1, y + m, ny - m, s);
+  }
+  s.w += hsum(w);
+  s.wd += hsum(wd);
+  s.rd += hsum(rd);
+  s.rx += hsum(rx);
+  s.nzero += size_t(hsum(nzero));
+};
+#endif
+
+#ifdef PAIRSUM_NEON
+static void sumPairsNEON(const double *x, size_t nx, const double *y,
+                         size_t ny, PairSum &s) {
+  const float64x2_t zero = vdupq_n_f64(0.0);
+  const float64x2_t one = vdupq_n_f64(1.0);
+  float64x2_t w = zero, wd = zero, rd = zero, rx = zero, nzero = zero;
+  size_t m = ny - ny % 2;
+  for (size_t i = 0; i < nx; ++i) {
+    float64x2_t xi = vdupq_n_f64(x[i]);
+    for (size_t j = 0; j < m; j += 2) {
+      float64x2_t yj = vld1q_f64(y + j);
+      float64x2_t len = vaddq_f64(xi, yj);
+      float64x2_t d = vsubq_f64(xi, yj);
+      uint64x2_t iszero = vceqq_f64(len, zero);
+      uint64x2_t positive = vcgtq_f64(len, zero);
+      float64x2_t wj =
+          vbslq_f64(iszero, zero, vdivq_f64(one, vmulq_f64(len, len)));
+      float64x2_t r = vmulq_f64(vmulq_f64(d, d), wj);
+      w = vaddq_f64(w, wj);
+      wd = vaddq_f64(wd, vmulq_f64(d, wj));
+      rx = vaddq_f64(rx, r);
+      rd = vaddq_f64(rd, vbslq_f64(positive, r, zero));
+      nzero = vaddq_f64(nzero, vbslq_f64(iszero, one, zero));
+    }
+    sumPairsScalar(x + i, 1, y + m, ny - m, s);
+  }
+  s.w += vaddvq_f64(w);
+  s.wd += vaddvq_f64(wd);
+  s.rd += vaddvq_f64(rd);
+  s.rx += vaddvq_f64(rx);
+  s.nzero += size_t(vaddvq_f64(nzero));
+};
+#endif
+
+vector<PairKernelInfo> pairKernels() {
+  vector<PairKernelInfo> kernels;
+#if defined(PAIRSUM_X86)
+  __builtin_cpu_init();
+  kernels.push_back(
+      {"AVX-512", sumPairsAVX512, bool(__builtin_cpu_supports("avx512f"))});
+  kernels.push_back(
+      {"AVX2", sumPairsAVX2, bool(__builtin_cpu_supports("avx2"))});
+#else
+  kernels.push_back({"AVX-512", NULL, false});
+  kernels.push_back({"AVX2", NULL, false});
+#endif
+#if defined(PAIRSUM_NEON)
+  kernels.push_back({"NEON", sumPairsNEON, true});
+#else
+  kernels.push_back({"NEON", NULL, false});
+#endif
+  kernels.push_back({"scalar", sumPairsScalar, true});
+  return kernels;
+};
+
+// the kernel for the cpu, it is checked once
+static PairKernel pairKernel() {
+  for (auto &k : pairKernels()) {
+    if (k.supported)
+      return k.kernel;
+  }
+  return sumPairsScalar;
+};
+
+void sumPairs(const double *x, size_t nx, const double *y, size_t ny,
+              PairSum &s) {
+  static const PairKernel kernel = pairKernel();
+
+  // the lanes are along the longer list, the difference is turned over
+  if (ny >= nx) {
+    kernel(x, nx, y, ny, s);
+  } else {
+    PairSum t;
+    kernel(y, ny, x, nx, t);
+    s += t.flip();
+  }
+};
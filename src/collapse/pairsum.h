@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of
+ * Sciences. See the accompanying Manual for the contributors and the way to
+ * cite this work. Comments and suggestions welcome. Please contact Dr.
+ * Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 16:05:40
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 23:32:05
+ */
+
+#ifndef PAIRSUM_H
+#define PAIRSUM_H
+
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+/********************************************************************************
+ * @brief the sums over the pairs of otus from two sides of a point: the
+ * weight 1/L^2 of the path length L, the weighted difference of two
+ * distances, and the weighted square of the difference for the paths longer
+ * than zero (in a side) and for the nonzero paths (across the root).
+ ********************************************************************************/
+struct PairSum {
+  double w, wd, rd, rx;
+  size_t nzero;
+
+  PairSum() : w(0), wd(0), rd(0), rx(0), nzero(0){};
+  PairSum &operator+=(const PairSum &s) {
+    w += s.w;
+    wd += s.wd;
+    rd += s.rd;
+    rx += s.rx;
+    nzero += s.nzero;
+    return *this;
+  };
+  PairSum flip() const {
+    PairSum s(*this);
+    s.wd = -wd;
+    return s;
+  };
+};
+
+// the sums of the pairs between two lists of distances, by the vector
+// instructions of the cpu (AVX-512, AVX2 or NEON) when there are
+void sumPairs(const double *, size_t, const double *, size_t, PairSum &);
+
+// the same by the scalar loop
+void sumPairsScalar(const double *, size_t, const double *, size_t,
+                    PairSum &);
+
+// the kernels of the sums in the order of preference, the scalar loop is the
+// last. A kernel not built for the cpu is NULL, and sumPairs uses the first
+// one supported.
+typedef void (*PairKernel)(const double *, size_t, const double *, size_t,
+                           PairSum &);
+struct PairKernelInfo {
+  const char *name;
+  PairKernel kernel;
+  bool supported;
+};
+vector<PairKernelInfo> pairKernels();
+
+#endif
@@ -18,14 +18,14 @@ void queryLineage(int argc, char *argv[]) {
   LngArgs myargs(argc, argv);
 
   // Initial the taxadb by the dump files
-  TaxaDB taxdb(myargs.dbpath);
+  TaxaRank rank;
+  TaxaDB taxdb(myargs.dbpath, &rank);
 
   // reset the rank abbreviation map
-  TaxaRank *rank = TaxaRank::create();
   if (!myargs.rankfile.empty())
-    rank->setRankByFile(myargs.rankfile);
+    rank.setRankByFile(myargs.rankfile);
   if (!myargs.outrank.empty())
-    rank->setOutRank(myargs.outrank);
+    rank.setOutRank(myargs.outrank);
 
   // do the search
   ofstream ofs(myargs.outfile);
@@ -67,8 +67,9 @@ void queryLineage(int argc, char *argv[]) {
 
     // format the output lineage string
     if (!myargs.outrank.empty()) {
+      LngFormat plan(rank);
       for (auto &it : hit) {
-        rank->format(it.second);
+        plan.format(it.second);
       }
     }
 
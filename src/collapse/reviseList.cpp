@@ -44,6 +44,9 @@ Revision::Revision(const string &file) {
     }
     is.close();
 
+    for (auto &p : chglist)
+      rules.emplace_back(p.first, p.second);
+
     if (chglist.empty()) {
       theInfo("There are no revsion on lineage in file " + file);
     } else {
@@ -57,31 +60,88 @@ Revision::Revision(const string &file) {
 
 bool Revision::empty() const { return chglist.empty(); };
 
-int Revision::revise(vector<string> &nmlist) {
+// the lineages are revised in parallel, each by the rules in order
+int Revision::revise(vector<string> &nmlist) const {
   int nReplace(0);
-  for (str2str &p : chglist) {
-    regex reg(p.first);
-    for (auto &nm : nmlist) {
-      string out = regex_replace(nm, reg, p.second);
-      if (nm.compare(out) != 0) {
-        ++nReplace;
-        nm = out;
-      }
-    }
-  }
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : nReplace) \
+    if (nmlist.size() > 1024)
+  for (size_t i = 0; i < nmlist.size(); ++i)
+    nReplace += revise(nmlist[i]);
+
   theInfo("There are " + to_string(nReplace) +
           "items had been replaced by revision file");
   return nReplace;
 }
 
-int Revision::revise(string &nm) {
+int Revision::revise(string &nm) const {
   int nReplace(0);
-  for (str2str &p : chglist) {
-    string out = regex_replace(nm, regex(p.first), p.second);
-    if (nm.compare(out) != 0) {
+  for (auto &rule : rules) {
+    if (rule.revise(nm))
       ++nReplace;
-      nm = out;
-    }
   }
   return nReplace;
-}
\ No newline at end of file
+}
+
+/********************************************************************************
+ * @brief Construct a new Revision Rule:: Revision Rule object
+ *
+ * @param pat the pattern of regex
+ * @param fmt the format for regex_replace
+ ********************************************************************************/
+RevisionRule::RevisionRule(const string &pat, const string &fmt)
+    : pattern(pat), format(fmt) {
+  const string special("^$\\.*+?()[]{}|");
+  literal = !pattern.empty() &&
+            pattern.find_first_of(special) == string::npos &&
+            format.find('$') == string::npos;
+  if (literal)
+    return;
+
+  try {
+    reg.assign(pattern);
+  } catch (const regex_error &) {
+    cerr << "Error regex in revision: " << pattern << endl;
+    exit(2);
+  }
+
+  // the leading literal of pattern, the char before a quantifier is optional,
+  // and no literal is sure for the pattern with alternatives
+  if (!pattern.empty() && pattern.find('|') == string::npos) {
+    size_t beg = (pattern.front() == '^') ? 1 : 0;
+    size_t end = pattern.find_first_of(special, beg);
+    if (end == string::npos)
+      end = pattern.size();
+    if (end < pattern.size() && end > beg &&
+        string("*?{").find(pattern[end]) != string::npos)
+      --end;
+    prefix = pattern.substr(beg, end - beg);
+  }
+}
+
+// replace as regex_replace, and return true if the lineage is changed
+bool RevisionRule::revise(string &nm) const {
+  if (literal) {
+    size_t pos = nm.find(pattern);
+    if (pos == string::npos || pattern == format)
+      return false;
+
+    string out;
+    size_t prev = 0;
+    for (; pos != string::npos; pos = nm.find(pattern, prev)) {
+      out.append(nm, prev, pos - prev);
+      out += format;
+      prev = pos + pattern.size();
+    }
+    out.append(nm, prev, string::npos);
+    nm.swap(out);
+    return true;
+  }
+
+  if (!prefix.empty() && nm.find(prefix) == string::npos)
+    return false;
+  string out = regex_replace(nm, reg, format);
+  if (nm.compare(out) == 0)
+    return false;
+  nm.swap(out);
+  return true;
+}
@@ -24,13 +24,27 @@
 
 using namespace std;
 typedef pair<string, string> str2str;
+
+// a revision rule compiled once, the plain rule is replaced as string
+struct RevisionRule {
+  string pattern, format;
+  bool literal;  // no regex syntax in the pattern and format
+  string prefix; // the literal part of pattern in all matched lineages
+  regex reg;
+
+  RevisionRule(const string &, const string &);
+  bool revise(string &) const;
+};
+
 struct Revision {
   vector<str2str> chglist;
+  vector<RevisionRule> rules;
 
+  Revision() = default;
   Revision(const string &);
   bool empty() const;
-  int revise(string &);
-  int revise(vector<string> &);
+  int revise(string &) const;
+  int revise(vector<string> &) const;
 };
 
 #endif
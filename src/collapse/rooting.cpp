@@ -18,10 +18,51 @@ void rooting(int argc, char *argv[]) {
   RootingArgs myargs(argc, argv);
 
   /************************************************************************
-   ******* read the tree and rooting by topology and branch ***************/
-  Node *aTree = new Node;
-  aTree->innwk(myargs.infile);
+   ******* read the trees and rooting by topology and branch **************/
+  MapFile nwk(myargs.infile);
+  if (!nwk.good()) {
+    cerr << "Cannot found the input tree file " << myargs.infile << endl;
+    exit(4);
+  }
+  vector<pair<const char *, const char *>> nwklist;
+  bool isBin = isBinTree(nwk.begin(), nwk.end());
+  if (isBin)
+    nwklist.emplace_back(nwk.begin(), nwk.end());
+  else
+    splitNwk(nwk.begin(), nwk.end(), nwklist);
+  if (nwklist.size() > 1)
+    theInfo("There are " + to_string(nwklist.size()) + " trees in file " +
+            myargs.infile);
+
+  // root trees in threads and keep the output in order
+  vector<string> results(nwklist.size());
+#pragma omp parallel for schedule(dynamic) if (nwklist.size() > 1)
+  for (size_t i = 0; i < nwklist.size(); ++i) {
+    NodePool pool;
+    Node *aTree = pool.newNode();
+    if (isBin)
+      aTree->inbin(nwklist[i].first, nwklist[i].second);
+    else
+      aTree->innwk(nwklist[i].first, nwklist[i].second, nwklist.size() == 1);
+    aTree = rootTree(aTree, myargs);
+
+    stringstream buf;
+    aTree->outnwk(buf);
+    results[i] = buf.str();
+  }
 
+  // output trees
+  ogzstream os(myargs.outfile);
+  if (!os) {
+    cerr << "Open " << myargs.outfile << " for write failed" << endl;
+    exit(3);
+  }
+  for (auto &str : results)
+    os << str;
+  os.close();
+}
+
+Node *rootTree(Node *aTree, const RootingArgs &myargs) {
   // rooting the tree by outgroup and branch length
   if (aTree->children.size() == 2) {
     theInfo("This tree is a rooted tree, keep as it is");
@@ -37,9 +78,7 @@ void rooting(int argc, char *argv[]) {
   } else {
     aTree = aTree->rootingByLength(myargs.rootMeth);
   }
-
-  // output tree
-  aTree->outnwk(myargs.outfile);
+  return aTree;
 }
 
 RootingArgs::RootingArgs(int argc, char **argv)
@@ -49,7 +88,7 @@ RootingArgs::RootingArgs(int argc, char **argv)
 
   char ch;
   while ((ch = getopt(argc, argv,
-                      "i::o:O::m:u:qh")) != -1) {
+                      "i:o:O:m:u:qh")) != -1) {
     switch (ch) {
     case 'i':
       infile = optarg;
@@ -78,8 +117,9 @@ void RootingArgs::usage() {
   cerr
       << "\nProgram Usage: \n\n"
       << program << "\n"
-      << " [ -i Tree.nwk ]     Input newick tree, default: Tree.nwk\n"
-      << " [ -o Rooted.nwk ]   Output rooted newick tree, default: Rooted.nwk \n"
+      << " [ -i Tree.nwk ]     Input newick tree(s) or binary tree,\n"
+      << "                     default: Tree.nwk\n"
+      << " [ -o Rooted.nwk ]   Output rooted newick tree(s), default: Rooted.nwk \n"
       << " [ -m mv ]           Set rooting method: mv, mad, mp, pmr, or md\n"
       << "                     default: mv\n"
       << " [ -O <Outgroup> ]   Rooting phylogenetic tree by outgroup.\n"
@@ -34,5 +34,6 @@ struct RootingArgs {
 };
 
 void rooting(int, char **);
+Node *rootTree(Node *, const RootingArgs &);
 
 #endif
\ No newline at end of file
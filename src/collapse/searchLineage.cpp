@@ -18,11 +18,11 @@ void searchLineage(int argc, char *argv[]) {
   UpLngArgs myargs(argc, argv);
 
   // set rank
-  TaxaRank *rank = TaxaRank::create();
-  rank->initial(myargs.rankfile, myargs.outrank);
+  TaxaRank rank;
+  rank.initial(myargs.rankfile, myargs.outrank);
 
   // set the lineage
-  LngData lngs(myargs.taxadb, myargs.taxfile, myargs.taxrev);
+  LngData lngs(&rank, myargs.taxadb, myargs.taxfile, myargs.taxrev);
   lngs.getLineage(myargs.nmlist);
 
   // output data
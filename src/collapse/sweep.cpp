@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of Sciences.
+ * See the accompanying Manual for the contributors and the way to cite this work.
+ * Comments and suggestions welcome. Please contact
+ * Dr. Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 14:13:02
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 14:13:02
+ */
+
+#include "sweep.h"
+
+void sweep(int argc, char *argv[]) {
+
+  // get the input arguments
+  SweepArgs myargs(argc, argv);
+
+  /************************************************************************
+   ******* read the tree and rooting by topology and branch ***************/
+  NodePool pool;
+  Node *aTree = pool.newNode();
+  aTree->innwk(myargs.infile, true);
+  aTree = rootingByInput(aTree, myargs.byBranch, myargs.outgrp,
+                         myargs.rootMeth);
+
+  /**********************************************************************
+   ********* get the lineages once and revise them by each file *********/
+  TaxaRank rank;
+  rank.initial(myargs.rankfile, myargs.outrank);
+  LngData lngs(&rank, myargs.taxadb, myargs.taxfile, "");
+
+  vector<Node *> allLeafs;
+  aTree->getLeafs(allLeafs);
+  theInfo("There are " + to_string(allLeafs.size()) +
+          " leafs in the phylogenetic tree: " + myargs.infile);
+
+  vector<string> nmlist;
+  for (auto nd : allLeafs) {
+    nmlist.emplace_back(nd->name);
+  }
+  lngs.findLineage(nmlist);
+  lngs.reviseLineage(Revision(), true);
+
+  // the lineages of leafs by each revision, the first is without revision,
+  // they are kept by ids in theLngTable
+  vector<string> revfiles(1, "None");
+  revfiles.insert(revfiles.end(), myargs.revfiles.begin(),
+                  myargs.revfiles.end());
+  size_t nRev = revfiles.size();
+  vector<vector<uint32_t>> leafLng(nRev);
+  vector<vector<bool>> leafDef(nRev);
+  for (size_t k = 0; k < nRev; ++k) {
+    LngData theLngs(lngs);
+    if (k > 0) {
+      theInfo("Revise the lineages by " + revfiles[k]);
+      theLngs.reviseLineage(Revision(revfiles[k]), false);
+    }
+    theLngs.checkRepeats();
+    for (auto &lng : theLngs.data) {
+      leafLng[k].emplace_back(theLngTable.intern(lng.name));
+      leafDef[k].emplace_back(lng.def);
+    }
+  }
+
+  /*************************************************************************
+   *********** rooting unrooted tree by the lineages without revision ******/
+  for (size_t i = 0; i < allLeafs.size(); ++i) {
+    allLeafs[i]->setOneLeaf(theLngTable[leafLng[0][i]], leafDef[0][i]);
+  }
+  aTree = rootingByLineage(aTree, myargs.rootMeth, myargs.otuLevel, rank);
+
+  // the leafs of rooted tree by the order of lineages
+  unordered_map<Node *, size_t> leafIndex;
+  for (size_t i = 0; i < allLeafs.size(); ++i) {
+    leafIndex.emplace(allLeafs[i], i);
+  }
+  vector<size_t> order;
+  aTree->forEachLeaf([&](Node *nd) { order.emplace_back(leafIndex[nd]); });
+
+  // the rooted tree is copied for each thread by the binary format
+  stringstream bin;
+  aTree->outbin(bin);
+  string treeBin = bin.str();
+
+  /**************************************************************************
+   ************ annotate the copies of tree by revisions in parallel ********/
+  vector<vector<TaxLevelState>> entropy(nRev);
+  vector<size_t> nStrain(nRev);
+#pragma omp parallel if (nRev > 1)
+  {
+    NodePool thePool;
+    Node *theTree = thePool.newNode();
+    theTree->inbin(treeBin.data(), treeBin.data() + treeBin.size());
+    vector<Node *> leafs, branches;
+    theTree->getLeafs(leafs);
+    theTree->getBranches(branches);
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t k = 0; k < nRev; ++k) {
+      LngData theLngs(&rank);
+      for (size_t i = 0; i < leafs.size(); ++i) {
+        size_t j = order[i];
+        leafs[i]->setOneLeaf(theLngTable[leafLng[k][j]], leafDef[k][j]);
+        theLngs.data.emplace_back(leafs[i]->getName());
+        theLngs.data.back().def = leafDef[k][j];
+      }
+      for (auto nd : branches) {
+        nd->unclassified = false;
+        nd->dirty = true;
+      }
+      theTree->updateBranches();
+
+      Taxa theTaxa(theLngs);
+      theTaxa.annotate(theTree);
+      theTaxa.getEntropy(entropy[k]);
+      nStrain[k] = theTaxa.def.nStrain;
+    }
+  }
+  theInfo("Done statistics of the taxonomy by " + to_string(nRev - 1) +
+          " revisions");
+
+  /***************************************************************************
+   *********  output data ****************************************************/
+  outSweep(revfiles, entropy, nStrain, rank, myargs.outPref + ".entropy");
+}
+/****************************************************************************
+ ******************************  End main program ***************************
+ ****************************************************************************/
+
+/**************************************************************************
+ * @brief output the entropies by revisions in one table, the columns are
+ * the same as the entropy file of run, headed by the revision file
+ *
+ * @param revfiles the revision files, the first is None
+ * @param entropy the states of out ranks by revisions
+ * @param nStrain the number of classified strains by revisions
+ * @param rank the ranks of lineages
+ * @param file the output file
+ ***************************************************************************/
+void outSweep(const vector<string> &revfiles,
+              const vector<vector<TaxLevelState>> &entropy,
+              const vector<size_t> &nStrain, const TaxaRank &rank,
+              const string &file) {
+  ofstream os(file);
+  if (!os) {
+    cerr << "Open " << file << " for write failed!" << endl;
+    exit(3);
+  }
+
+  os << "revision" << "\t" << "rank" << "\t" << "#Solo" << "\t"
+     << "#Molo" << "\t" << "#Taxa" << "\t" << "Htaxa" << "\t"
+     << "Htree" << "\t" << "~H" << endl;
+
+  for (size_t k = 0; k < revfiles.size(); ++k) {
+    for (size_t i = 0; i < entropy[k].size(); ++i) {
+      os << revfiles[k] << "\t" << rank.outrank[i].first << "\t";
+      entropy[k][i].output(os, nStrain[k]);
+    }
+  }
+  os.close();
+};
+
+SweepArgs::SweepArgs(int argc, char **argv)
+    : infile(""), taxfile(""), outgrp(""), rootMeth("mv"), otuLevel(""),
+      byBranch(false) {
+
+  program = argv[0];
+  string outname("sweep");
+  string supdir("./");
+  vector<string> words;
+
+  char ch;
+  while ((ch = getopt(argc, argv, "i:d:D:o:S:r:R:O:l:m:u:Bqh")) != -1) {
+    switch (ch) {
+    case 'i':
+      infile = optarg;
+      break;
+    case 'D':
+      supdir = optarg;
+      break;
+    case 'd':
+      taxadb = optarg;
+      break;
+    case 'o':
+      outname = optarg;
+      break;
+    case 'S':
+      separateWord(words, optarg);
+      revfiles.insert(revfiles.end(), words.begin(), words.end());
+      break;
+    case 'r':
+      outrank = optarg;
+      break;
+    case 'R':
+      rankfile = optarg;
+      break;
+    case 'O':
+      outgrp = optarg;
+      break;
+    case 'l':
+      taxfile = optarg;
+      break;
+    case 'm':
+      rootMeth = toLower(optarg);
+      break;
+    case 'u':
+      otuLevel = toUpper(optarg);
+      break;
+    case 'B':
+      byBranch = true;
+      break;
+    case 'q':
+      theInfo.quiet = true;
+      break;
+    case 'h':
+      usage();
+    case '?':
+      usage();
+    }
+  }
+
+  // the revision files can also be given after the options
+  for (int i = optind; i < argc; ++i)
+    revfiles.emplace_back(argv[i]);
+  if (revfiles.empty()) {
+    cerr << "No revision file for sweep" << endl;
+    usage();
+  }
+
+  // the workdir
+  addsuffix(supdir, '/');
+
+  // the input tree file
+  if (infile.empty())
+    infile = supdir + "Tree.nwk";
+
+  // the input lineage file
+  if (taxfile.empty()) {
+    taxfile = supdir + "Lineage.lns";
+    if (!fileExists(taxfile))
+      taxfile = supdir + "Lineage.csv";
+  }
+
+  // the output prefix
+  outPref = supdir + outname;
+
+  // for the default
+  if (taxadb.empty()) {
+    taxadb = supdir + "taxadb.gz";
+    if (!fileExists(taxadb)) {
+      taxadb = supdir + "taxdump.tar.gz";
+      if (!fileExists(taxadb)) {
+        taxadb = supdir + "taxdump/";
+      }
+    }
+  }
+}
+
+void SweepArgs::usage() {
+  cerr
+      << "\nProgram Usage: \n\n"
+      << program << " [options] <revision files>\n"
+      << " [ -D ./ ]              The work directory, default: ./\n"
+      << " [ -i Tree.nwk ]        Input newick tree, default: Tree.nwk\n"
+      << " [ -o sweep ]           Set prefix name of output files, \n"
+      << "                        default: sweep\n"
+      << " [ -S <None> ]          Lineage substitute files to compare,\n"
+      << "                        separated by comma, default: None\n"
+      << " [ -l Lineage.lns ]     Input lineage file for leaves of tree, \n"
+      << "                        default: Lineage.lns or Lineage.csv\n"
+      << " [ -d taxadb.gz ]       Taxonomy data file or directory,\n"
+      << "                        default: taxadb.gz or taxdump.tar.gz\n"
+      << " [ -R <None> ]          List of rank names and abbrivations,\n"
+      << "                        default: set by program\n"
+      << " [ -r DKPCOFGS ]        Abbreviations of output taxon rank,\n"
+      << "                        default: set by program\n"
+      << " [ -m mv ]              Set rooting method: mv, mad, mp, pmr, or md\n"
+      << "                        default: mv\n"
+      << " [ -u <None> ]          Set the taxon level for OTU for rooting\n"
+      << "                        default: the top division taxon level\n"
+      << " [ -B ]                 Rooting phylogenetic tree by branch length\n"
+      << "                        default: No, rooting by taxonomy\n"
+      << " [ -O <Outgroup> ]      Rooting phylogenetic tree by outgroup.\n"
+      << "                        default: None, rooting by taxonomy\n"
+      << " [ -q ]                 Run command in quiet mode\n"
+      << " [ -h ]                 Display this information\n"
+      << endl;
+  exit(1);
+}
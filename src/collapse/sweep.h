@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of Sciences.
+ * See the accompanying Manual for the contributors and the way to cite this work.
+ * Comments and suggestions welcome. Please contact
+ * Dr. Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 14:12:45
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 14:12:45
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include "collapse.h"
+using namespace std;
+
+// read arguments
+struct SweepArgs {
+  string program;
+  string infile;
+  string taxadb, taxfile;
+  vector<string> revfiles;
+  string rankfile, outrank;
+  string outPref;
+  string outgrp;
+  string rootMeth;
+  string otuLevel;
+  bool byBranch;
+
+  SweepArgs(int, char **);
+  void usage();
+};
+
+void sweep(int, char **);
+void outSweep(const vector<string> &, const vector<vector<TaxLevelState>> &,
+              const vector<size_t> &, const TaxaRank &, const string &);
+
+#endif
@@ -24,11 +24,9 @@ ostream &operator<<(ostream &os, const TaxonNode &tax) {
  * @brief Construct a new TaxaDB:: TaxaDB object
  *
  * @param fnode path of nodes.dmp
+ * @param rk the rank context for the lineages
  ********************************************************************************/
-TaxaDB::TaxaDB(const string &path) {
-  // create the TaxaRank object
-  rank = TaxaRank::create();
-
+TaxaDB::TaxaDB(const string &path, TaxaRank *rk) : rank(rk) {
   // set the system
   if (isDirectory(path)) {
 
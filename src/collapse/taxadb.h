@@ -51,7 +51,7 @@ struct TaxaDB {
 
 
   // build from dump files
-  TaxaDB(const string &);
+  TaxaDB(const string &, TaxaRank *);
   string goodname(const string&);
   string idname(const string&);
   void tgz4taxdb(const string&);
@@ -12,19 +12,8 @@
 
 #include "taxarank.h"
 
-/********************************************************************************
- * @brief factory function for TaxaRank to keep it only one copy in program
- *
- ********************************************************************************/
-pair<char, char> TaxaRank::mark = make_pair('<', '>');
-
-TaxaRank *TaxaRank::pRank = nullptr;
-TaxaRank *TaxaRank::create() {
-  if (pRank == nullptr) {
-    pRank = new TaxaRank();
-  }
-  return pRank;
-};
+// the marks around the rank abbreviation in lineages
+const pair<char, char> TaxaRank::mark = make_pair('<', '>');
 
 /********************************************************************************
  * @brief set rank
@@ -109,7 +98,7 @@ void TaxaRank::setOutRank(const vector<pair<string, char>> &rnlist, bool fix) {
  *
  * @param os
  ********************************************************************************/
-void TaxaRank::outRanksJson(ostream &os) {
+void TaxaRank::outRanksJson(ostream &os) const {
   vector<string> jslist;
   for (auto &rank : outrank) {
     jslist.emplace_back("{\"level\":\"" + rank.first + "\",\"symbol\":\"" +
@@ -118,7 +107,7 @@ void TaxaRank::outRanksJson(ostream &os) {
   os << "[" << strjoin(jslist.begin(), jslist.end(), ',') << "]";
 };
 
-void TaxaRank::outRanksCSV(ostream &os) {
+void TaxaRank::outRanksCSV(ostream &os) const {
   vector<string> csvlist;
   for (auto &rank : outrank) {
     csvlist.emplace_back(rank.first + "(" + rank.second + ")");
@@ -132,11 +121,11 @@ void TaxaRank::outRanksCSV(ostream &os) {
  ********************************************************************************/
 size_t TaxaRank::nOutRanks() const { return outrank.size(); };
 
-bool TaxaRank::wellDefined(const string &lng) {
+bool TaxaRank::wellDefined(const string &lng) const {
   return lng.find(undefSym) == string::npos;
 };
 
-string TaxaRank::lineage(const string &lng, const string &str) {
+string TaxaRank::lineage(const string &lng, const string &str) const {
   if (lng.find(strainMark) == string::npos) {
     return lng + strainMark + str;
   }
@@ -144,40 +133,74 @@ string TaxaRank::lineage(const string &lng, const string &str) {
 };
 
 // format the lineage string according to outRank
-void TaxaRank::format(string &atax) {
+void TaxaRank::format(string &atax) const { LngFormat(*this).format(atax); };
+
+/********************************************************************************
+ * @brief Construct a new Lng Format:: Lng Format object
+ *
+ * @param rank the out ranks and symbols for the format
+ ********************************************************************************/
+LngFormat::LngFormat(const TaxaRank &rank)
+    : undefStr(rank.undefStr), strainMark(rank.strainMark),
+      domain(TaxaRank::addMark('D')), kingdom(TaxaRank::addMark('K')) {
+  for (auto &t : rank.outrank)
+    labels.emplace_back(TaxaRank::addMark(t.second));
+};
 
-  string str = atax;
-  atax.clear();
-  for (auto &t : outrank) {
-    string tlab = addMark(t.second);
-    auto bpos = str.find(tlab);
+void LngFormat::format(string &atax) const {
+  const char mark = TaxaRank::mark.first;
+  string str;
+  str.reserve(atax.size() + labels.size() * (undefStr.size() + 3));
+  for (auto &tlab : labels) {
+    auto bpos = atax.find(tlab);
     if (bpos == string::npos) {
-      atax += tlab;
-      atax += undefStr;
+      str += tlab;
+      str += undefStr;
     } else {
-      auto epos = str.find_first_of(mark.first, bpos + 1);
-      atax += str.substr(bpos, epos - bpos);
+      auto epos = atax.find(mark, bpos + 1);
+      str.append(atax, bpos, epos == string::npos ? epos : epos - bpos);
     }
   }
 
   // for the strain name
-  auto bpos = str.rfind(strainMark);
+  auto bpos = atax.rfind(strainMark);
   if (bpos == string::npos) {
     // don't find <T> label
-    atax += strainMark;
-    bpos = str.find_last_of(mark.second);
+    str += strainMark;
+    bpos = atax.find_last_of(TaxaRank::mark.second);
     bpos = (bpos == string::npos) ? 0 : bpos + 1;
   }
+  auto epos = atax.find(mark, bpos + 1);
+  str.append(atax, bpos, epos == string::npos ? epos : epos - bpos);
 
-  auto epos = str.find_first_of(mark.first, bpos + 1);
-  if (epos == string::npos) {
-    atax += str.substr(bpos);
-  } else {
-    atax += str.substr(bpos, epos - bpos);
-  }
+  _fixKingdom(str);
+  atax.swap(str);
+};
 
-  // for replace domain name to the missing kingdom name
-  atax = regex_replace(atax, misKingdom, comKingdom);
+// replace the missing kingdom name by the domain name, as regex_replace of
+// "<D>([A-Za-z]+)<K>Unclassified" by "<D>$1<K>$1"
+void LngFormat::_fixKingdom(string &str) const {
+  auto isLetter = [](char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+  };
+
+  size_t pos = 0;
+  while ((pos = str.find(domain, pos)) != string::npos) {
+    size_t beg = pos + domain.size();
+    size_t end = beg;
+    while (end < str.size() && isLetter(str[end]))
+      ++end;
+
+    size_t upos = end + kingdom.size();
+    if (end > beg && str.compare(end, kingdom.size(), kingdom) == 0 &&
+        str.compare(upos, undefStr.size(), undefStr) == 0) {
+      string name(str, beg, end - beg);
+      str.replace(upos, undefStr.size(), name);
+      pos = upos + name.size();
+    } else {
+      ++pos;
+    }
+  }
 };
 
 /********************************************************************************
@@ -214,7 +237,7 @@ string TaxaRank::rankString(const RankName &rn) const {
 }
 
 // output the rank index
-int TaxaRank::rankindex(const string &str) {
+int TaxaRank::rankindex(const string &str) const {
   if (str.size() == 1) {
     char c = str[0];
     for (int i = 0; i < outrank.size(); ++i) {
@@ -237,47 +260,79 @@ int TaxaRank::rankindex(const string &str) {
  * @brief functions for the option on lineages
  *
  ********************************************************************************/
-size_t parseLineage(const string &taxstr, vector<string> &tax) {
-  size_t prev_pos = 0;
-  size_t pos = 1;
-  while ((pos = taxstr.find_first_of(TaxaRank::mark.first, pos)) !=
-         string::npos) {
-    tax.emplace_back(taxstr.substr(0, pos));
-    ++pos;
-  }
-  tax.emplace_back(taxstr);
+// the next rank mark in [p, end), or end if none
+static inline const char *nextMark(const char *p, const char *end) {
+  if (p >= end)
+    return end;
+  auto q = (const char *)memchr(p, TaxaRank::mark.first, end - p);
+  return q == NULL ? end : q;
+};
+
+// the prefixes ended before each rank mark but the first, and the lineage
+template <class T>
+static size_t _parseLineage(string_view taxstr, vector<T> &tax) {
+  const char *beg = taxstr.data(), *end = beg + taxstr.size();
+  for (auto p = nextMark(beg + 1, end); p != end; p = nextMark(p + 1, end))
+    tax.emplace_back(beg, p - beg);
+  tax.emplace_back(beg, taxstr.size());
   return tax.size();
 };
 
-size_t separateLineage(const string &taxstr, vector<string> &tax) {
-  size_t prev_pos = 0;
-  size_t pos = 1;
-  while ((pos = taxstr.find_first_of(TaxaRank::mark.first, prev_pos + 1)) !=
-         string::npos) {
-    tax.emplace_back(taxstr.substr(prev_pos, pos - prev_pos));
-    prev_pos = pos;
+// the segments started at each rank mark
+template <class T>
+static size_t _separateLineage(string_view taxstr, vector<T> &tax) {
+  const char *prev = taxstr.data(), *end = prev + taxstr.size();
+  for (auto p = nextMark(prev + 1, end); p != end; p = nextMark(p + 1, end)) {
+    tax.emplace_back(prev, p - prev);
+    prev = p;
   }
-  tax.emplace_back(taxstr.substr(prev_pos));
+  tax.emplace_back(prev, end - prev);
   return tax.size();
 };
 
+size_t parseLineage(const string &taxstr, vector<string> &tax) {
+  return _parseLineage(taxstr, tax);
+};
+
+size_t parseLineage(string_view taxstr, vector<string_view> &tax) {
+  return _parseLineage(taxstr, tax);
+};
+
+size_t separateLineage(const string &taxstr, vector<string> &tax) {
+  return _separateLineage(taxstr, tax);
+};
+
+size_t separateLineage(string_view taxstr, vector<string_view> &tax) {
+  return _separateLineage(taxstr, tax);
+};
+
+string_view lastNameView(string_view str) {
+  auto pos = str.rfind(TaxaRank::mark.first);
+  if (pos == string_view::npos)
+    return string_view();
+  return str.substr(pos);
+};
+
 string lastName(const string &str) {
-  auto pos = str.find_last_of(TaxaRank::mark.first);
-  if (pos != string::npos) {
-    return str.substr(pos);
-  } else {
+  auto name = lastNameView(str);
+  if (name.empty()) {
     cerr << "failed to parse the lineage name string: " << str << endl;
     exit(3);
   }
+  return string(name);
 };
 
-string lastNameNoRank(const string &str) {
-  size_t pos = str.find_last_of(TaxaRank::mark.second);
-  if (pos == string::npos)
+string_view lastNameNoRankView(string_view str) {
+  size_t pos = str.rfind(TaxaRank::mark.second);
+  if (pos == string_view::npos)
     return str;
   return str.substr(pos + 1);
 };
 
+string lastNameNoRank(const string &str) {
+  return string(lastNameNoRankView(str));
+};
+
 string commonLineage(const string &lngA, const string &lngB) {
 
   string comlng;
@@ -317,20 +372,109 @@ string commonLineage(const vector<string> &lngs) {
 };
 
 // delete the strain section in lineage
-string delStrain(const string &lng) {
-  size_t npos = lng.find(TaxaRank::addMark('T'));
-  if (npos != string::npos) {
+string_view delStrainView(string_view lng) {
+  const char strain[] = {TaxaRank::mark.first, 'T', TaxaRank::mark.second};
+  size_t npos = lng.find(string_view(strain, sizeof(strain)));
+  if (npos != string_view::npos)
     return lng.substr(0, npos);
-  }
   return lng;
 };
 
+string delStrain(const string &lng) { return string(delStrainView(lng)); };
+
 // number ranks
-size_t nRanks(const string &lng) {
-  size_t n = 0;
-  for (auto c : lng) {
-    if (c == TaxaRank::mark.first)
-      n++;
+size_t nRanks(string_view lng) {
+  return count(lng.begin(), lng.end(), TaxaRank::mark.first);
+};
+
+size_t nRanks(const string &lng) { return nRanks(string_view(lng)); };
+
+/********************************************************************************
+ * @brief the intern table of lineages
+ *
+ ********************************************************************************/
+LngTable theLngTable;
+const uint32_t LNG_UNKNOWN(numeric_limits<uint32_t>::max());
+
+LngTable::LngTable() : blocks{}, nEntry(0) { _add("", 0); };
+
+LngTable::~LngTable() {
+  for (auto blk : blocks)
+    delete[] blk;
+};
+
+uint32_t LngTable::intern(const string &lng) {
+  {
+    shared_lock<shared_mutex> lock(mtx);
+    auto iter = index.find(lng);
+    if (iter != index.end())
+      return iter->second;
   }
-  return n;
-}
+
+  // the parent is the lineage without the last rank, as in parseLineage
+  uint32_t pid = 0;
+  size_t pos = lng.find_last_of(TaxaRank::mark.first);
+  if (pos != string::npos && pos > 0)
+    pid = intern(lng.substr(0, pos));
+
+  return _add(lng, pid);
+};
+
+// add the lineage if it is not added by the other threads in the meantime
+uint32_t LngTable::_add(const string &lng, uint32_t pid) {
+  unique_lock<shared_mutex> lock(mtx);
+  auto iter = index.find(lng);
+  if (iter != index.end())
+    return iter->second;
+
+  size_t id = nEntry.load(memory_order_relaxed);
+  if (id > numeric_limits<uint32_t>::max() - 1) {
+    cerr << "Too many lineages for the lineage table" << endl;
+    exit(5);
+  }
+  Entry *&blk = blocks[id >> BLOCK_BITS];
+  if (blk == nullptr)
+    blk = new Entry[BLOCK_SIZE];
+
+  Entry &ent = blk[id & (BLOCK_SIZE - 1)];
+  ent.str = lng;
+  ent.parent = pid;
+  ent.depth = (id == 0) ? 0 : _entry(pid).depth + 1;
+  ent.rank = ::nRanks(lng);
+  ent.strainless.store(id == 0 ? 0 : LNG_UNKNOWN, memory_order_relaxed);
+  index.emplace(ent.str, id);
+  nEntry.store(id + 1, memory_order_release);
+  return id;
+};
+
+uint32_t LngTable::find(string_view lng) const {
+  shared_lock<shared_mutex> lock(mtx);
+  auto iter = index.find(lng);
+  return iter == index.end() ? 0 : iter->second;
+};
+
+uint32_t LngTable::common(uint32_t a, uint32_t b) const {
+  // the lowest common ancestor by walking up the trie, the depth is the
+  // number of ranks and so the walk is short
+  if (a == 0 || b == 0)
+    return 0;
+  while (_entry(a).depth > _entry(b).depth)
+    a = _entry(a).parent;
+  while (_entry(b).depth > _entry(a).depth)
+    b = _entry(b).parent;
+  while (a != b) {
+    a = _entry(a).parent;
+    b = _entry(b).parent;
+  }
+  return a;
+};
+
+uint32_t LngTable::noStrain(uint32_t id) {
+  const Entry &ent = _entry(id);
+  uint32_t sid = ent.strainless.load(memory_order_relaxed);
+  if (sid == LNG_UNKNOWN) {
+    sid = intern(delStrain(ent.str));
+    ent.strainless.store(sid, memory_order_relaxed);
+  }
+  return sid;
+};
@@ -14,20 +14,28 @@
 #define TAXARANK_H
 
 #include "kit.h"
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <map>
-#include <regex>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 using namespace std;
 
 typedef pair<string, string> RankName;
 
+/********************************************************************************
+ * @brief the context of taxon ranks: the rank names, their abbreviations and
+ * the out ranks. Each job keeps its own context, and passes it to the lineage
+ * data, the taxonomy database and the taxa system, so the jobs with different
+ * ranks can run in one process.
+ ********************************************************************************/
 struct TaxaRank {
-  // for keep one copy in program
-  static TaxaRank *pRank;
-  static TaxaRank *create();
-
   // mark option
-  static pair<char, char> mark;
+  const static pair<char, char> mark;
   template <class T> static string addMark(T sym) {
     string title;
     title += mark.first;
@@ -40,8 +48,6 @@ struct TaxaRank {
   string undefStr{"Unclassified"};
   string undefSym{mark.second + undefStr + mark.first};
   string strainMark{addMark('T')};
-  regex misKingdom{addMark('D') + "([A-Za-z]+)" + addMark('K') + undefStr};
-  string comKingdom{addMark('D') + "$1" + addMark('K') + "$1"};
 
   // taxon rank map and list
   map<string, char> rankmap{
@@ -68,14 +74,14 @@ struct TaxaRank {
   void setOutRank(const vector<pair<string, char>> &, bool fix = false);
 
   // output rank in formats
-  void outRanksJson(ostream &);
-  void outRanksCSV(ostream &);
+  void outRanksJson(ostream &) const;
+  void outRanksCSV(ostream &) const;
 
   // for check
   size_t nOutRanks() const;
-  bool wellDefined(const string &);
-  void format(string &);
-  string lineage(const string &, const string &);
+  bool wellDefined(const string &) const;
+  void format(string &) const;
+  string lineage(const string &, const string &) const;
 
   // convert linage style
   char getSymbol(const string &) const;
@@ -83,10 +89,24 @@ struct TaxaRank {
   string rankString(const vector<RankName> &) const;
 
   //output the rank index
-  int rankindex(const string&);
+  int rankindex(const string&) const;
+};
+
+/********************************************************************************
+ * @brief the plan to format lineage strings by the out ranks, it is compiled
+ * once for the current out ranks, and can be shared by threads
+ *
+ ********************************************************************************/
+struct LngFormat {
+  LngFormat(const TaxaRank &);
+  void format(string &) const;
 
 private:
-  TaxaRank() = default;
+  vector<string> labels; // the marks of out ranks
+  string undefStr, strainMark;
+  string domain, kingdom; // the marks for the missing kingdom name
+
+  void _fixKingdom(string &) const;
 };
 
 // comman options
@@ -99,4 +119,60 @@ string commonLineage(const vector<string> &);
 string delStrain(const string &);
 size_t nRanks(const string &);
 
+// the non-allocating options, the views point into the given lineage, which
+// must outlive them
+size_t parseLineage(string_view, vector<string_view> &);
+size_t separateLineage(string_view, vector<string_view> &);
+string_view lastNameView(string_view); // empty if no rank
+string_view lastNameNoRankView(string_view);
+string_view delStrainView(string_view);
+size_t nRanks(string_view);
+
+/********************************************************************************
+ * @brief the intern table of lineages, each lineage is kept once and referred
+ * by a 32-bit id, and the id 0 is the empty lineage. The lineages form a trie
+ * by their ranks: the parent of a lineage is the lineage without its last
+ * rank, so the common lineage is the lowest common ancestor in the trie. The
+ * lineages are kept in blocks which are never moved, so it is thread safe to
+ * add lineages while reading the others.
+ ********************************************************************************/
+struct LngTable {
+  LngTable();
+  ~LngTable();
+  LngTable(const LngTable &) = delete;
+  LngTable &operator=(const LngTable &) = delete;
+
+  uint32_t intern(const string &);
+  uint32_t find(string_view) const; // 0 if not interned
+  const string &operator[](uint32_t id) const { return _entry(id).str; };
+  size_t size() const { return nEntry.load(memory_order_acquire); };
+
+  uint32_t common(uint32_t, uint32_t) const;
+  uint32_t noStrain(uint32_t);
+  uint32_t parent(uint32_t id) const { return _entry(id).parent; };
+  size_t nRanks(uint32_t id) const { return _entry(id).rank; };
+
+private:
+  struct Entry {
+    string str;
+    uint32_t parent, depth;
+    size_t rank;
+    mutable atomic<uint32_t> strainless; // set at the first query
+  };
+  static const size_t BLOCK_BITS = 16;
+  static const size_t BLOCK_SIZE = size_t(1) << BLOCK_BITS;
+
+  Entry *blocks[size_t(1) << (32 - BLOCK_BITS)];
+  atomic<size_t> nEntry;
+  unordered_map<string_view, uint32_t> index;
+  mutable shared_mutex mtx; // for the index and adding lineages
+
+  const Entry &_entry(uint32_t id) const {
+    return blocks[id >> BLOCK_BITS][id & (BLOCK_SIZE - 1)];
+  };
+  uint32_t _add(const string &, uint32_t);
+};
+
+extern LngTable theLngTable;
+
 #endif // !TAXARANK_H
\ No newline at end of file
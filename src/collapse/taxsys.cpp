@@ -16,6 +16,7 @@
  * default value for static members of taxsys
  ********************************************************************************/
 const string TaxSys::rootTaxon("<B>Cellular_Organisms");
+const uint32_t TaxSys::NONE(numeric_limits<uint32_t>::max());
 
 /********************************************************************************
  * @brief Construct a new Tax Sys:: Tax Sys object
@@ -25,90 +26,185 @@ const string TaxSys::rootTaxon("<B>Cellular_Organisms");
 TaxSys::TaxSys(const vector<string> &names) { initial(names); };
 
 void TaxSys::initial(const vector<string> &names) {
-  // set the total number of the taxonomy set
-  nStrain = names.size();
-
-  // set the state map
-  for (auto &nm : names) {
-    vector<string> taxlist;
-    parseLineage(nm, taxlist);
-    taxlist.pop_back();
-    for (auto &tax : taxlist) {
-      if (state.find(tax) != state.end()) {
-        ++state[tax].nStrain;
-      } else {
-        state[tax] = TaxonState();
-      }
+  nStrain = 0;
+  slot.assign(theLngTable.size(), NONE);
+  for (auto &nm : names)
+    addStrain(theLngTable.intern(nm));
+};
+
+// set the states, the taxa of a lineage are its ancestors in the lineage
+// trie, i.e. the prefixes by parseLineage except the lineage itself
+void TaxSys::addStrain(uint32_t lng) {
+  ++nStrain;
+  for (uint32_t id = theLngTable.parent(lng); id != 0;
+       id = theLngTable.parent(id)) {
+    if (id < slot.size() && slot[id] != NONE) {
+      ++state[slot[id]].nStrain;
+    } else {
+      _state(id);
     }
   }
 };
 
-void TaxSys::annotateBranch(size_t nleaf, int nClade, string &name,
-                            size_t &taxSize) {
+// the taxa without strain are removed by renewState after unmerge
+void TaxSys::delStrain(uint32_t lng) {
+  --nStrain;
+  for (uint32_t id = theLngTable.parent(lng); id != 0;
+       id = theLngTable.parent(id)) {
+    if (id < slot.size() && slot[id] != NONE)
+      --state[slot[id]].nStrain;
+  }
+};
+
+// the state of a taxon, inserted if not exists as by operator[] of map
+TaxonState &TaxSys::_state(uint32_t id) {
+  if (id >= slot.size())
+    slot.resize(theLngTable.size(), NONE);
+  if (slot[id] == NONE) {
+    slot[id] = taxa.size();
+    taxa.emplace_back(id);
+    state.emplace_back();
+  }
+  return state[slot[id]];
+};
+
+const TaxonState *TaxSys::find(string_view str) const {
+  return find(theLngTable.find(str));
+};
+
+const TaxonState *TaxSys::find(uint32_t id) const {
+  if (id == 0 || id >= slot.size() || slot[id] == NONE)
+    return NULL;
+  return &state[slot[id]];
+};
+
+// remove a taxon by moving the last one into its place
+void TaxSys::_erase(uint32_t id) {
+  size_t i = slot[id];
+  slot[taxa.back()] = i;
+  taxa[i] = taxa.back();
+  state[i] = std::move(state.back());
+  taxa.pop_back();
+  state.pop_back();
+  slot[id] = NONE;
+};
+
+// the index of taxa in the order of their lineages
+vector<size_t> TaxSys::order() const {
+  vector<size_t> idx(taxa.size());
+  iota(idx.begin(), idx.end(), 0);
+  sort(idx.begin(), idx.end(),
+       [this](size_t a, size_t b) { return name(a) < name(b); });
+  return idx;
+};
+
+// the number of strains of a taxon, 1 as the default state if not exists
+size_t TaxSys::_nStrain(uint32_t id) const {
+  if (id >= slot.size() || slot[id] == NONE)
+    return 1;
+  return state[slot[id]].nStrain;
+};
+
+void TaxSys::annotateBranch(size_t nleaf, int nClade, uint32_t lng,
+                            string &name, uint32_t &split, size_t &taxSize,
+                            TaxaShard &shard) const {
 
-  if (name.empty()) {
+  if (lng == 0) {
     name = "|" + rootTaxon;
+    split = NO_SPLIT;
     taxSize = nStrain;
   } else {
-    // reset the name of the node
-    vector<string> taxlist;
-    parseLineage(name, taxlist);
-
-    // set the clades
-    for (size_t i = 1; i <= nClade; ++i) {
-      state[taxlist[taxlist.size() - i]].distract.emplace_back(nleaf);
+    // set the clades, the lineage and its ancestors
+    uint32_t id = lng;
+    for (size_t i = 1; i <= nClade && id != 0; ++i) {
+      shard.distract.emplace_back(id, nleaf);
+      id = theLngTable.parent(id);
     }
 
     // set taxSize
-    auto iter = taxlist.rbegin();
-    auto stateIter = state.find(*iter);
-    taxSize = stateIter->second.nStrain;
-    if (stateIter->second.nStrain == nleaf) {
-      stateIter->second.monophy = true;
+    taxSize = _nStrain(lng);
+    if (taxSize == nleaf) {
+      shard.monophy.emplace_back(lng);
     }
 
     // set the name of node
     size_t npos(0);
-    for (++iter; iter != taxlist.rend(); ++iter) {
-      stateIter = state.find(*iter);
-      if (stateIter->second.nStrain == nleaf) {
-        stateIter->second.monophy = true;
+    for (id = theLngTable.parent(lng); id != 0; id = theLngTable.parent(id)) {
+      if (_nStrain(id) == nleaf) {
+        shard.monophy.emplace_back(id);
       } else {
-        npos = iter->size();
+        npos = theLngTable[id].size();
         break;
       }
     }
-    name.insert(npos, "|");
+    name.clear();
+    split = npos;
   }
 };
 
-void TaxSys::annotateLeaf(int nClade, string &name, size_t &taxSize) {
+void TaxSys::annotateLeaf(int nClade, uint32_t lng, uint32_t &split,
+                          size_t &taxSize, TaxaShard &shard) const {
 
   // for the case only one strain
   taxSize = 1;
 
-  // reset the name of the node
-  vector<string> taxlist;
-  parseLineage(name, taxlist);
-  taxlist.pop_back();
-
-  // set the clades
-  for (int i = 1; i < nClade; ++i) {
-    state[taxlist[taxlist.size() - i]].distract.emplace_back(1);
+  // set the clades, the ancestors of the lineage
+  uint32_t id = theLngTable.parent(lng);
+  for (int i = 1; i < nClade && id != 0; ++i) {
+    shard.distract.emplace_back(id, 1);
+    id = theLngTable.parent(id);
   }
 
-  // set node name
+  // set the split of node name
   size_t npos(0);
-  for (auto iter = taxlist.rbegin(); iter != taxlist.rend(); ++iter) {
-    auto stateIter = state.find(*iter);
-    if (stateIter->second.nStrain == 1) {
-      stateIter->second.monophy = true;
+  for (id = theLngTable.parent(lng); id != 0; id = theLngTable.parent(id)) {
+    if (_nStrain(id) == 1) {
+      shard.monophy.emplace_back(id);
     } else {
-      npos = iter->size();
+      npos = theLngTable[id].size();
       break;
     }
   }
-  name.insert(npos, "|");
+  split = npos;
+};
+
+void TaxSys::merge(const TaxaShard &shard) {
+  for (auto &d : shard.distract)
+    _state(d.first).distract.emplace_back(d.second);
+  for (auto id : shard.monophy)
+    _state(id).monophy = true;
+};
+
+// remove one count of the clade sizes, the monophyly is set by renewState
+void TaxSys::unmerge(const TaxaShard &shard) {
+  for (auto &d : shard.distract) {
+    if (d.first >= slot.size() || slot[d.first] == NONE)
+      continue;
+    vector<size_t> &distract = state[slot[d.first]].distract;
+    auto iter = std::find(distract.begin(), distract.end(), d.second);
+    if (iter != distract.end())
+      distract.erase(iter);
+  }
+};
+
+// a taxon is monophyletic if its strains are in one clade, and the taxon
+// without any clade is not in the tree anymore
+void TaxSys::renewState(uint32_t id) {
+  if (id >= slot.size() || slot[id] == NONE)
+    return;
+
+  TaxonState &st = state[slot[id]];
+  if (st.distract.empty()) {
+    _erase(id);
+  } else {
+    st.monophy = st.distract.size() == 1 && st.distract[0] == st.nStrain;
+  }
+};
+
+// the number of strains for output, 1 for the taxon not in the system
+static size_t _outStrain(const TaxSys &sys, const string &str) {
+  auto st = sys.find(str);
+  return st == NULL ? 1 : st->nStrain;
 };
 
 //..... Combine the classified and unclassified tax system
@@ -128,32 +224,55 @@ Taxa::Taxa(const LngData &lngs) {
     }
   }
 
-  rank = rank->create();
+  rank = lngs.rank;
 
   def.initial(defNames);
   undef.initial(undefNames);
 };
 
 void Taxa::annotate(Node *aTree) {
-  // set taxonomy of leafs
-  vector<Node *> allLeafs;
-  aTree->getLeafs(allLeafs);
-  for (auto &nd : allLeafs) {
+  // the leafs are annotated before the branches
+  vector<Node *> nodes;
+  aTree->getLeafs(nodes);
+  vector<Node *> allBraches;
+  aTree->getBranches(allBraches);
+  nodes.insert(nodes.end(), allBraches.begin(), allBraches.end());
+
+  // annotate the blocks of nodes by threads, and merge the changes on states
+  // by the order of blocks, so that the result is the same as in serial
+  int nBlock = nThreads();
+  vector<TaxaShard> defShard(nBlock), undefShard(nBlock);
+#pragma omp parallel for schedule(static, 1) if (nBlock > 1)
+  for (int i = 0; i < nBlock; ++i) {
+    size_t beg = nodes.size() * i / nBlock;
+    size_t end = nodes.size() * (i + 1) / nBlock;
+    for (size_t j = beg; j < end; ++j)
+      annotate(nodes[j], defShard[i], undefShard[i]);
+  }
+
+  for (int i = 0; i < nBlock; ++i) {
+    def.merge(defShard[i]);
+    undef.merge(undefShard[i]);
+  }
+};
+
+void Taxa::annotate(Node *nd, TaxaShard &defShard,
+                    TaxaShard &undefShard) const {
+  if (nd->isLeaf()) {
     if (nd->unclassified) {
-      undef.annotateLeaf(nd->nClade(), nd->name, nd->taxSize);
+      undef.annotateLeaf(nd->nClade(), nd->lng, nd->split, nd->taxSize,
+                         undefShard);
     } else {
-      def.annotateLeaf(nd->nClade(), nd->name, nd->taxSize);
+      def.annotateLeaf(nd->nClade(), nd->lng, nd->split, nd->taxSize,
+                       defShard);
     }
-  }
-
-  // annotetate taxonomy of all nodes
-  vector<Node *> allBraches;
-  aTree->getBranches(allBraches);
-  for (auto &nd : allBraches) {
+  } else {
     if (nd->unclassified) {
-      undef.annotateBranch(nd->nxleaf, nd->nClade(), nd->name, nd->taxSize);
+      undef.annotateBranch(nd->nxleaf, nd->nClade(), nd->lng, nd->name,
+                           nd->split, nd->taxSize, undefShard);
     } else {
-      def.annotateBranch(nd->nleaf, nd->nClade(), nd->name, nd->taxSize);
+      def.annotateBranch(nd->nleaf, nd->nClade(), nd->lng, nd->name,
+                         nd->split, nd->taxSize, defShard);
     }
   }
 };
@@ -175,9 +294,9 @@ void Taxa::outTax(const string &file) {
 };
 
 void Taxa::outTax(ostream &os) {
-  for (const auto &st : def.state) {
-    os << lastName(st.first) << ":" << st.second.nStrain;
-    if (st.second.monophy)
+  for (auto i : def.order()) {
+    os << lastName(def.name(i)) << ":" << def.state[i].nStrain;
+    if (def.state[i].monophy)
       os << " ++" << endl;
     else
       os << " --" << endl;
@@ -203,8 +322,8 @@ void Taxa::outUnclass(vector<string> &strName, const string &file) {
 
 void Taxa::outUnclass(vector<string> &strName, ostream &os) {
   vector<string> taxName;
-  for (auto &str : undef.state)
-    taxName.push_back(str.first);
+  for (auto i : undef.order())
+    taxName.push_back(undef.name(i));
 
   for (auto &str : strName)
     str.erase(str.find('|'), 1);
@@ -214,7 +333,7 @@ void Taxa::outUnclass(vector<string> &strName, ostream &os) {
   merge(taxName.begin(), taxName.end(), strName.begin(), strName.end(),
         back_inserter(names));
   for (auto &str : names)
-    os << lastName(str) << ':' << undef.state[str].nStrain << endl;
+    os << lastName(str) << ':' << _outStrain(undef, str) << endl;
 };
 
 /********************************************************************************
@@ -234,61 +353,81 @@ void Taxa::outEntropy(const string &file) {
 };
 
 void Taxa::outEntropy(ostream &os) {
+  vector<TaxLevelState> taxlev;
+  getEntropy(taxlev);
 
-  map<char, TaxLevelState> taxlev;
-  for (const auto &atax : rank->outrank) {
-    TaxLevelState tl;
-    taxlev[atax.second] = tl;
+   os << "rank" << "\t" << "#Solo" << "\t"
+       << "#Molo" << "\t" << "#Taxa" << "\t" << "Htaxa" << "\t"
+       << "Htree" << "\t" << "~H" <<  endl;
+
+  for (size_t i = 0; i < taxlev.size(); ++i) {
+    os << rank->outrank[i].first << "\t";
+    taxlev[i].output(os, def.nStrain);
+  }
+
+  // output the strain data
+  // os << "Strain"
+  //    << "\t" << def.nStrain << "\t" << 0 << "\t" << def.nStrain << "\t"
+  //    << fixed << setprecision(3) << maxEntropy << "\t" << maxEntropy 
+  //    << "\t" << "-" << endl;
+};
+
+/********************************************************************************
+ * @brief get the numbers of taxa and the sums for entropy on out ranks
+ *
+ * @param taxlev the states of levels, in the order of out ranks
+ ********************************************************************************/
+void Taxa::getEntropy(vector<TaxLevelState> &taxlev) const {
+
+  map<char, size_t> index;
+  for (size_t i = 0; i < rank->outrank.size(); ++i) {
+    index.emplace(rank->outrank[i].second, i);
   }
+  taxlev.assign(rank->outrank.size(), TaxLevelState());
 
-  for (auto &stateIter : def.state) {
+  for (auto i : def.order()) {
+    const TaxonState &st = def.state[i];
 
-    string theItem = lastName(stateIter.first);
-    char abbrT = theItem[1];
+    string theItem = lastName(def.name(i));
+    auto iter = index.find(theItem[1]);
+    if (iter == index.end())
+      continue;
+    TaxLevelState &tl = taxlev[iter->second];
 
     // get the collapse state and sigle strain taxon
-    if (stateIter.second.nStrain == 1) {
-      ++taxlev[abbrT].nSolo;
+    if (st.nStrain == 1) {
+      ++tl.nSolo;
     } else {
       // get number of non-solo taxon
-      if (stateIter.second.monophy)
-        ++taxlev[abbrT].nMono;
+      if (st.monophy)
+        ++tl.nMono;
       else
-        ++taxlev[abbrT].nPoly;
+        ++tl.nPoly;
 
       // get the entropy
-      taxlev[abbrT].sTax +=
-          stateIter.second.nStrain * log2(double(stateIter.second.nStrain));
-      for (auto &n : stateIter.second.distract) {
-        taxlev[abbrT].sTree += n * log2(double(n));
+      tl.sTax += st.nStrain * log2(double(st.nStrain));
+      for (auto &n : st.distract) {
+        tl.sTree += n * log2(double(n));
       }
     }
   }
 
-   os << "rank" << "\t" << "#Solo" << "\t"
-       << "#Molo" << "\t" << "#Taxa" << "\t" << "Htaxa" << "\t"
-       << "Htree" << "\t" << "~H" <<  endl;
-
-  double maxEntropy = log2(double(def.nStrain));
-  for (const auto &atax : rank->outrank) {
-    int nTotal = taxlev[atax.second].nSolo + taxlev[atax.second].nMono +
-                 taxlev[atax.second].nPoly;
-    double sTax = maxEntropy - taxlev[atax.second].sTax / def.nStrain;
-    double sTree = maxEntropy - taxlev[atax.second].sTree / def.nStrain;
-    double sRelative = taxlev[atax.second].sTree / taxlev[atax.second].sTax;
-
-    // output taxlevel data
-    os << atax.first << "\t" << taxlev[atax.second].nSolo << "\t"
-       << taxlev[atax.second].nMono << "\t" << nTotal << "\t" 
-       << fixed << setprecision(3)<< sTax << "\t"
-       << sTree <<"\t" << sRelative << endl;
+  // the same states for the repeated abbreviations
+  for (size_t i = 0; i < taxlev.size(); ++i) {
+    taxlev[i] = taxlev[index[rank->outrank[i].second]];
   }
+};
 
-  // output the strain data
-  // os << "Strain"
-  //    << "\t" << def.nStrain << "\t" << 0 << "\t" << def.nStrain << "\t"
-  //    << fixed << setprecision(3) << maxEntropy << "\t" << maxEntropy 
-  //    << "\t" << "-" << endl;
+void TaxLevelState::output(ostream &os, size_t nStrain) const {
+  int nTotal = nSolo + nMono + nPoly;
+  double maxEntropy = log2(double(nStrain));
+  double hTax = maxEntropy - sTax / nStrain;
+  double hTree = maxEntropy - sTree / nStrain;
+  double sRelative = sTree / sTax;
+
+  // output taxlevel data
+  os << nSolo << "\t" << nMono << "\t" << nTotal << "\t" << fixed
+     << setprecision(3) << hTax << "\t" << hTree << "\t" << sRelative << endl;
 };
 
 /********************************************************************************
@@ -316,17 +455,18 @@ void Taxa::outStatitics(ostream &os) {
     // get the statistic of monophyly
     size_t nMul(0), nSol(0);
     vector<string> tlist;
-    for (auto &stateIter : def.state) {
-      string theItem = lastName(stateIter.first);
+    for (size_t k = 0; k < def.taxa.size(); ++k) {
+      const TaxonState &st = def.state[k];
+      string theItem = lastName(def.name(k));
       if (theItem[1] == abbr) {
         // get the number of strain
         theItem.append(":");
-        theItem.append(to_string(stateIter.second.nStrain));
+        theItem.append(to_string(st.nStrain));
 
         // get the collapse state and sigle strain taxon
-        if (stateIter.second.monophy) {
+        if (st.monophy) {
           theItem.append("\t++");
-          if (stateIter.second.nStrain == 1)
+          if (st.nStrain == 1)
             ++nSol;
           else
             ++nMul;
@@ -335,11 +475,11 @@ void Taxa::outStatitics(ostream &os) {
 
         // get the divide
         theItem.append("\t{");
-        theItem.append(to_string(stateIter.second.distract[0]));
+        theItem.append(to_string(st.distract[0]));
 
-        for (int i = 1; i < stateIter.second.distract.size(); ++i) {
+        for (int i = 1; i < st.distract.size(); ++i) {
           theItem.append("|");
-          theItem.append(to_string(stateIter.second.distract[i]));
+          theItem.append(to_string(st.distract[i]));
         }
         theItem.append("}");
         tlist.emplace_back(theItem);
@@ -379,25 +519,26 @@ void Taxa::outJsonEntropy(ostream &os) {
     taxlev[atax.second] = tl;
   }
 
-  for (auto &stateIter : def.state) {
+  for (auto i : def.order()) {
+    const TaxonState &st = def.state[i];
 
-    string theItem = lastName(stateIter.first);
+    string theItem = lastName(def.name(i));
     char abbrT = theItem[1];
 
     // get the collapse state and sigle strain taxon
-    if (stateIter.second.nStrain == 1) {
+    if (st.nStrain == 1) {
       ++taxlev[abbrT].nSolo;
     } else {
       // get number of non-solo taxon
-      if (stateIter.second.monophy)
+      if (st.monophy)
         ++taxlev[abbrT].nMono;
       else
         ++taxlev[abbrT].nPoly;
 
       // get the entropy
       taxlev[abbrT].sTax +=
-          stateIter.second.nStrain * log2(double(stateIter.second.nStrain));
-      for (auto &n : stateIter.second.distract) {
+          st.nStrain * log2(double(st.nStrain));
+      for (auto &n : st.distract) {
         taxlev[abbrT].sTree += n * log2(double(n));
       }
     }
@@ -430,8 +571,8 @@ void Taxa::outJsonEntropy(ostream &os) {
 void Taxa::outJsonUnclass(vector<string> &strName, ostream &os) {
   // get undefine strain lineage
   vector<string> taxName;
-  for (auto &str : undef.state)
-    taxName.push_back(str.first);
+  for (auto i : undef.order())
+    taxName.push_back(undef.name(i));
   for (auto &str : strName)
     str.erase(str.find('|'), 1);
   sort(strName.begin(), strName.end());
@@ -461,7 +602,7 @@ void Taxa::outJsonUnclass(vector<string> &strName, ostream &os) {
       os << "},{";
     }
     os << "\"name\":\"" << lastName(str) << "\","
-       << "\"size\":\"" << undef.state[str].nStrain << "\"";
+       << "\"size\":\"" << _outStrain(undef, str) << "\"";
     prevRank = theRank;
   }
 
@@ -472,14 +613,16 @@ void Taxa::outJsonUnclass(vector<string> &strName, ostream &os) {
 
 void Taxa::outJsonTax(ostream &os) {
   // for state is empty
-  if (def.state.empty())
+  if (def.taxa.empty())
     return;
 
   // output the json string
   size_t prevRank = 0;
   os << "[";
-  for (const auto &st : def.state) {
-    size_t theRank = nRanks(st.first);
+  for (auto i : def.order()) {
+    const string &nm = def.name(i);
+    const TaxonState &st = def.state[i];
+    size_t theRank = nRanks(nm);
     if (prevRank == 0) {
       os << "{";
     } else if (theRank > prevRank) {
@@ -495,12 +638,292 @@ void Taxa::outJsonTax(ostream &os) {
     } else {
       os << "},{";
     }
-    os << "\"name\":\"" << lastName(st.first) << "\","
-       << "\"size\":\"" << st.second.nStrain << "\","
-       << "\"status\":\"" << ((st.second.monophy) ? "++" : "--") << "\"";
+    os << "\"name\":\"" << lastName(nm) << "\","
+       << "\"size\":\"" << st.nStrain << "\","
+       << "\"status\":\"" << ((st.monophy) ? "++" : "--") << "\"";
     prevRank = theRank;
   }
   for (size_t iRank = 0; iRank != prevRank; ++iRank) {
     os << "}]";
   }
 };
+
+/********************************************************************************
+ * @brief Construct a new Tree Updater object, annotate the tree as
+ * Taxa::annotate and keep the nodes counted in distract of each taxon
+ *
+ * @param tx the taxa of the leafs, not annotated yet
+ * @param aTree the tree with lineages of nodes
+ ********************************************************************************/
+TreeUpdater::TreeUpdater(Taxa &tx, Node *aTree)
+    : taxa(tx), tree(aTree), maxId(0) {
+  // the leafs are annotated before the branches
+  vector<Node *> nodes;
+  tree->getLeafs(nodes);
+  vector<Node *> allBraches;
+  tree->getBranches(allBraches);
+  nodes.insert(nodes.end(), allBraches.begin(), allBraches.end());
+
+  for (auto nd : nodes)
+    maxId = max(maxId, nd->id);
+  _annotate(nodes);
+  defTouched.clear();
+  undefTouched.clear();
+};
+
+// the nodes on the path from the node to root and their children, their
+// annotations depend on the subtree of the node
+static void _around(Node *nd, vector<Node *> &nodes) {
+  for (Node *prev = NULL; nd != NULL; prev = nd, nd = nd->parent) {
+    nodes.emplace_back(nd);
+    for (auto child : nd->children) {
+      if (child != prev)
+        nodes.emplace_back(child);
+    }
+  }
+};
+
+// renew the lineages of branches on the path from the node to root
+static void _renewPath(Node *nd, Node *aTree) {
+  for (; nd != NULL; nd = nd->parent) {
+    if (!nd->isLeaf()) {
+      nd->unclassified = false;
+      nd->dirty = true;
+    }
+  }
+  aTree->updateBranches();
+};
+
+Node *TreeUpdater::insertLeaf(Node *sibling, const string &lineage, bool def,
+                              double length) {
+  vector<Node *> nodes;
+  _around(sibling, nodes);
+  _release(nodes);
+
+  // the new branch takes the place of the sibling
+  Node *leaf = sibling->_newNode();
+  Node *branch = sibling->_newNode();
+  leaf->id = ++maxId;
+  branch->id = ++maxId;
+  leaf->length = length;
+  if (sibling->parent == NULL) {
+    tree = branch;
+  } else {
+    branch->length = sibling->length / 2;
+    sibling->length -= branch->length;
+    Node *pnode = sibling->parent;
+    *find(pnode->children.begin(), pnode->children.end(), sibling) = branch;
+    branch->parent = pnode;
+  }
+  branch->addChild(sibling);
+  branch->addChild(leaf);
+
+  // set the lineage of the new leaf, and the strain in taxonomy
+  leaf->setOneLeaf(lineage, def);
+  vector<bool> monophy = _monophy(leaf);
+  (def ? taxa.def : taxa.undef).addStrain(leaf->lng);
+  _renewPath(branch, tree);
+
+  nodes.clear();
+  _around(branch, nodes);
+  _annotate(nodes);
+  _rename(leaf, 1, monophy);
+  _renew();
+  return leaf;
+};
+
+void TreeUpdater::deleteLeaf(Node *leaf) {
+  Node *pnode = leaf->parent;
+  if (pnode == NULL) {
+    cerr << "Cannot delete the root of tree: " << leaf->getName() << endl;
+    exit(1);
+  }
+
+  vector<bool> monophy = _monophy(leaf);
+  vector<Node *> nodes;
+  _around(pnode, nodes);
+  _release(nodes);
+
+  pnode->deleteChild(leaf);
+  leaf->parent = NULL;
+  (leaf->unclassified ? taxa.undef : taxa.def).delStrain(leaf->lng);
+
+  // remove the branch with one child
+  Node *changed = pnode;
+  if (pnode->children.size() == 1) {
+    Node *child = pnode->children.front();
+    if (pnode->parent == NULL) {
+      child->length = pnode->length;
+      child->parent = NULL;
+      tree = child;
+      changed = child;
+    } else {
+      child->length += pnode->length;
+      changed = pnode->parent;
+      *find(changed->children.begin(), changed->children.end(), pnode) = child;
+      child->parent = changed;
+    }
+    pnode->children.clear();
+  }
+  _renewPath(changed, tree);
+
+  nodes.clear();
+  _around(changed, nodes);
+  _annotate(nodes);
+  _rename(leaf, -1, monophy);
+  _renew();
+};
+
+// remove the states and the index counted by the nodes
+void TreeUpdater::_release(const vector<Node *> &nodes) {
+  TaxaShard defShard, undefShard;
+  for (auto nd : nodes) {
+    nd->split = NO_SPLIT;
+    taxa.annotate(nd, defShard, undefShard);
+    taxa.def.unmerge(defShard);
+    taxa.undef.unmerge(undefShard);
+    _index(nd, defShard, undefShard, false);
+  }
+};
+
+// annotate the nodes, and add the states and the index counted by them
+void TreeUpdater::_annotate(const vector<Node *> &nodes) {
+  TaxaShard defShard, undefShard;
+  for (auto nd : nodes) {
+    nd->split = NO_SPLIT;
+    taxa.annotate(nd, defShard, undefShard);
+    taxa.def.merge(defShard);
+    taxa.undef.merge(undefShard);
+    _index(nd, defShard, undefShard, true);
+  }
+};
+
+// add or remove the node in the index by its changes on taxa, the shards are
+// cleared for the next node
+void TreeUpdater::_index(Node *nd, TaxaShard &defShard, TaxaShard &undefShard,
+                         bool add) {
+  auto renew = [nd, add](TopIndex &tops, TopIndex &heads,
+                         vector<uint32_t> &touched, TaxaShard &shard) {
+    for (auto &d : shard.distract) {
+      if (add)
+        tops[d.first].emplace(nd);
+      else
+        tops[d.first].erase(nd);
+      touched.emplace_back(d.first);
+    }
+
+    // the branch counted in its own lineage is the top of the lineage
+    if (!nd->isLeaf() && !shard.distract.empty() &&
+        shard.distract.front().first == nd->lng) {
+      if (add)
+        heads[nd->lng].emplace(nd);
+      else
+        heads[nd->lng].erase(nd);
+    }
+    shard.distract.clear();
+    shard.monophy.clear();
+  };
+  renew(defTops, defHeads, defTouched, defShard);
+  renew(undefTops, undefHeads, undefTouched, undefShard);
+};
+
+// the monophyly of the taxa of the leaf before the change
+vector<bool> TreeUpdater::_monophy(Node *leaf) const {
+  const TaxSys &sys = leaf->unclassified ? taxa.undef : taxa.def;
+  vector<bool> monophy;
+  for (uint32_t id = theLngTable.parent(leaf->lng); id != 0;
+       id = theLngTable.parent(id)) {
+    auto st = sys.find(id);
+    monophy.emplace_back(st != NULL && st->monophy);
+  }
+  return monophy;
+};
+
+/********************************************************************************
+ * @brief annotate again the nodes depend on the number of strains of the taxa
+ * of the inserted or deleted leaf. They are the nodes with the lineage of the
+ * taxa, found from the top ones, and the nodes with all strains of the taxa
+ * before or after the change, which exist only if the taxa are monophyletic
+ * before or after the change.
+ *
+ * @param leaf the inserted or deleted leaf
+ * @param delta the change on the number of strains
+ * @param monophy the monophyly of the taxa before the change
+ ********************************************************************************/
+void TreeUpdater::_rename(Node *leaf, int delta, const vector<bool> &monophy) {
+  bool unclassified = leaf->unclassified;
+  const TaxSys &sys = unclassified ? taxa.undef : taxa.def;
+  TopIndex &tops = unclassified ? undefTops : defTops;
+  TopIndex &heads = unclassified ? undefHeads : defHeads;
+  vector<uint32_t> &touched = unclassified ? undefTouched : defTouched;
+
+  // the clade size of node in the taxonomy system, zero for the other system
+  auto count = [unclassified](Node *nd) -> size_t {
+    if (nd->unclassified != unclassified)
+      return 0;
+    return unclassified ? nd->nxleaf : nd->nleaf;
+  };
+  auto isFull = [&count](Node *nd, size_t n, size_t m) {
+    size_t c = count(nd);
+    return c > 0 && (c == n || c == m);
+  };
+
+  TaxaShard shard;
+  vector<Node *> stack;
+  size_t k = 0;
+  for (uint32_t id = theLngTable.parent(leaf->lng); id != 0;
+       id = theLngTable.parent(id), ++k) {
+    touched.emplace_back(id);
+    auto st = sys.find(id);
+    if (st == NULL)
+      continue;
+    size_t n = st->nStrain;
+    size_t m = n - delta;
+
+    // only the size of taxon is changed for the nodes with its lineage
+    auto iter = heads.find(id);
+    if (iter != heads.end())
+      stack.insert(stack.end(), iter->second.begin(), iter->second.end());
+    while (!stack.empty()) {
+      Node *nd = stack.back();
+      stack.pop_back();
+      nd->taxSize = n;
+      for (auto child : nd->children) {
+        if (child->lng == id && count(child) > 0)
+          stack.emplace_back(child);
+      }
+    }
+
+    // the names are changed for the nodes with all strains of the taxon
+    bool isMono = st->distract.size() == 1 && st->distract[0] == n;
+    iter = tops.find(id);
+    if ((monophy[k] || isMono) && iter != tops.end()) {
+      for (auto nd : iter->second) {
+        if (isFull(nd, n, m))
+          stack.emplace_back(nd);
+      }
+    }
+    while (!stack.empty()) {
+      Node *nd = stack.back();
+      stack.pop_back();
+      nd->split = NO_SPLIT;
+      taxa.annotate(nd, shard, shard);
+      for (auto child : nd->children) {
+        if (isFull(child, n, m))
+          stack.emplace_back(child);
+      }
+    }
+    shard.distract.clear();
+    shard.monophy.clear();
+  }
+};
+
+// renew the monophyly of the changed taxa
+void TreeUpdater::_renew() {
+  for (auto id : defTouched)
+    taxa.def.renewState(id);
+  for (auto id : undefTouched)
+    taxa.undef.renewState(id);
+  defTouched.clear();
+  undefTouched.clear();
+};
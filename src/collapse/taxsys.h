@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <string>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "kit.h"
@@ -42,6 +44,9 @@ struct TaxLevelState {
   int nSolo, nMono, nPoly;
   double sTax, sTree;
   TaxLevelState() : nSolo(0), nMono(0), nPoly(0), sTax(0), sTree(0){};
+
+  // output the numbers and the entropies by the total number of strains
+  void output(ostream &, size_t) const;
 };
 
 /********************************************************************************
@@ -55,22 +60,56 @@ struct TaxonState {
   TaxonState() : monophy(false), nStrain(1){};
 };
 
+/********************************************************************************
+ * @brief the changes on the taxon states by annotating a block of nodes, they
+ * are kept by each thread and merged into the taxonomy system in order
+ *
+ ********************************************************************************/
+struct TaxaShard {
+  vector<pair<uint32_t, size_t>> distract; // the taxa and their clade sizes
+  vector<uint32_t> monophy;                // the taxa found monophyletic
+};
+
 /********************************************************************************
  * @brief the taxonomy system for statistics and annotate the tree
  *
  ********************************************************************************/
 struct TaxSys {
   const static string rootTaxon;
+  const static uint32_t NONE;
 
   size_t nStrain;
-  map<string, TaxonState> state;
+  vector<uint32_t> taxa;    // the lineage ids of taxa in theLngTable
+  vector<TaxonState> state; // the states of taxa, parallel to taxa
 
   TaxSys() = default;
   TaxSys(const vector<string> &);
   void initial(const vector<string> &);
 
-  void annotateBranch(size_t, int, string &, size_t &);
-  void annotateLeaf(int, string &, size_t &);
+  // annotate nodes without changing the states, which is done by merge
+  void annotateBranch(size_t, int, uint32_t, string &, uint32_t &, size_t &,
+                      TaxaShard &) const;
+  void annotateLeaf(int, uint32_t, uint32_t &, size_t &, TaxaShard &) const;
+  void merge(const TaxaShard &);
+
+  // change the states by the inserted or deleted strains and nodes
+  void addStrain(uint32_t);
+  void delStrain(uint32_t);
+  void unmerge(const TaxaShard &);
+  void renewState(uint32_t);
+
+  // the taxa for output
+  const string &name(size_t i) const { return theLngTable[taxa[i]]; };
+  const TaxonState *find(string_view) const;
+  const TaxonState *find(uint32_t) const;
+  vector<size_t> order() const;
+
+private:
+  vector<uint32_t> slot; // the index of taxa by lineage id
+
+  TaxonState &_state(uint32_t);
+  size_t _nStrain(uint32_t) const;
+  void _erase(uint32_t);
 };
 
 /********************************************************************************
@@ -84,6 +123,7 @@ struct Taxa {
   Taxa(const LngData &);
 
   void annotate(Node *);
+  void annotate(Node *, TaxaShard &, TaxaShard &) const;
 
   void outTax(ostream &);
   void outTax(const string &);
@@ -91,6 +131,7 @@ struct Taxa {
   void outUnclass(vector<string> &, const string &);
   void outStatitics(ostream &);
   void outStatitics(const string &);
+  void getEntropy(vector<TaxLevelState> &) const;
   void outEntropy(ostream &);
   void outEntropy(const string &);
   void outJsonEntropy(ostream &);
@@ -99,4 +140,32 @@ struct Taxa {
   void outJson(const string &);
 };
 
+/********************************************************************************
+ * @brief to insert and delete leafs of an annotated tree, only the nodes around
+ * the changed path and the nodes of the changed taxa are annotated again
+ *
+ ********************************************************************************/
+struct TreeUpdater {
+  Taxa &taxa;
+  Node *tree;
+
+  TreeUpdater(Taxa &, Node *);
+  Node *insertLeaf(Node *, const string &, bool, double);
+  void deleteLeaf(Node *);
+
+private:
+  typedef unordered_map<uint32_t, unordered_set<Node *>> TopIndex;
+  TopIndex defTops, undefTops;   // the nodes counted in distract of taxa
+  TopIndex defHeads, undefHeads; // the top nodes with the lineage of taxa
+  vector<uint32_t> defTouched, undefTouched; // the taxa to be renewed
+  size_t maxId;
+
+  void _release(const vector<Node *> &);
+  void _annotate(const vector<Node *> &);
+  void _index(Node *, TaxaShard &, TaxaShard &, bool);
+  vector<bool> _monophy(Node *) const;
+  void _rename(Node *, int, const vector<bool> &);
+  void _renew();
+};
+
 #endif
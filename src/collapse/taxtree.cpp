@@ -11,38 +11,152 @@
  */
 
 #include "taxtree.h"
-const size_t N_FORKS(2);
+#include "flattree.h"
+const size_t NODE_SLAB(1024);
+const size_t NWK_PARALLEL_SIZE(1 << 20);
+
+/*******************************************************************/
+/********* Member Functions For Children and NodePool **************/
+/*******************************************************************/
+Children::Children(const vector<Node *> &vn) : Children() {
+  reserve(vn.size());
+  for (auto nd : vn)
+    emplace_back(nd);
+};
+
+Children::Children(const Children &c) : Children() { *this = c; };
+
+Children &Children::operator=(const Children &c) {
+  if (this != &c) {
+    nsize = 0;
+    reserve(c.nsize);
+    copy(c.begin(), c.end(), ptr);
+    nsize = c.nsize;
+  }
+  return *this;
+};
+
+Children::~Children() {
+  if (ptr != local)
+    delete[] ptr;
+};
+
+void Children::reserve(size_t n) {
+  if (n > ncap) {
+    Node **p = new Node *[n];
+    copy(begin(), end(), p);
+    if (ptr != local)
+      delete[] ptr;
+    ptr = p;
+    ncap = n;
+  }
+};
+
+void Children::emplace_back(Node *nd) {
+  if (nsize == ncap)
+    reserve(2 * ncap);
+  ptr[nsize++] = nd;
+};
+
+Children::iterator Children::erase(iterator iter) {
+  copy(iter + 1, end(), iter);
+  --nsize;
+  return iter;
+};
+
+// each pool has its own serial, so a slab kept by a thread is never taken
+// for a later pool at the same address
+static atomic<size_t> nodePoolSerial(0);
+
+// the serials of live pools, a thread drops the slabs of the others when it
+// starts on a new pool, so it keeps no more than the pools it works on
+static set<size_t> livePools;
+
+NodePool::NodePool() : serial(++nodePoolSerial) {
+#pragma omp critical(nodePool)
+  livePools.emplace(serial);
+};
+
+NodePool::~NodePool() {
+  current().erase(serial);
+#pragma omp critical(nodePool)
+  livePools.erase(serial);
+
+  // release the nodes slab by slab without walking the trees
+  for (auto slab : slabs) {
+    for (size_t i = 0; i < slab->used; ++i)
+      slab->nodes[i].~Node();
+    ::operator delete(slab->nodes);
+    delete slab;
+  }
+};
+
+// the slabs in use by the thread for each pool, it works for any team size
+// and for the nested regions
+unordered_map<size_t, NodePool::Slab *> &NodePool::current() {
+  static thread_local unordered_map<size_t, Slab *> slabInUse;
+  return slabInUse;
+};
+
+Node *NodePool::newNode() {
+  auto &inUse = current();
+  auto iter = inUse.find(serial);
+  if (iter == inUse.end()) {
+#pragma omp critical(nodePool)
+    for (auto it = inUse.begin(); it != inUse.end();) {
+      if (livePools.count(it->first) == 0)
+        it = inUse.erase(it);
+      else
+        ++it;
+    }
+    iter = inUse.emplace(serial, (Slab *)NULL).first;
+  }
+
+  Slab *&slab = iter->second;
+  if (slab == NULL || slab->used == NODE_SLAB) {
+    slab = new Slab{(Node *)::operator new(NODE_SLAB * sizeof(Node)), 0};
+#pragma omp critical(nodePool)
+    slabs.emplace_back(slab);
+  }
+
+  Node *nd = new (slab->nodes + slab->used++) Node;
+  nd->pool = this;
+  return nd;
+};
+
+size_t NodePool::size() const {
+  size_t n = 0;
+  for (auto slab : slabs)
+    n += slab->used;
+  return n;
+};
 
 /*******************************************************************/
 /********* Member Functions For Node Class *************************/
 /*******************************************************************/
 Node::Node()
-    : name(""), id(0), length(NAN), depth(NAN), varsum(NAN), parent(NULL),
-      taxSize(0), taxLevel(0), nleaf(1), nxleaf(0), unclassified(false),
-      uploaded(false), otu(false) {
-  children.reserve(N_FORKS);
-};
+    : name(""), id(0), length(NAN), bootstrap(NAN), depth(NAN), varsum(NAN), parent(NULL),
+      pool(NULL), taxSize(0), taxLevel(0), nleaf(1), nxleaf(0), nUpLeaf(0),
+      unclassified(false), uploaded(false), otu(false), dirty(true), lng(0),
+      split(NO_SPLIT){};
 
 Node::Node(size_t n)
-    : name(""), id(n), length(NAN), depth(NAN), varsum(NAN), parent(NULL),
-      taxSize(0), taxLevel(0), nleaf(1), nxleaf(0), unclassified(false),
-      uploaded(false), otu(false) {
-  children.reserve(N_FORKS);
-};
+    : name(""), id(n), length(NAN), bootstrap(NAN), depth(NAN), varsum(NAN), parent(NULL),
+      pool(NULL), taxSize(0), taxLevel(0), nleaf(1), nxleaf(0), nUpLeaf(0),
+      unclassified(false), uploaded(false), otu(false), dirty(true), lng(0),
+      split(NO_SPLIT){};
 
 Node::Node(size_t n, const string &str)
-    : name(str), id(n), length(NAN), depth(NAN), varsum(NAN), parent(NULL),
-      taxSize(0), taxLevel(0), nleaf(1), nxleaf(0), unclassified(false),
-      uploaded(false), otu(false) {
-  children.reserve(N_FORKS);
-};
+    : name(str), id(n), length(NAN), bootstrap(NAN), depth(NAN), varsum(NAN), parent(NULL),
+      pool(NULL), taxSize(0), taxLevel(0), nleaf(1), nxleaf(0), nUpLeaf(0),
+      unclassified(false), uploaded(false), otu(false), dirty(true), lng(0),
+      split(NO_SPLIT){};
 
 Node::Node(size_t n, const vector<Node *> &vn)
-    : name(""), id(n), length(NAN), depth(NAN), varsum(NAN), parent(NULL),
-      children(vn), taxSize(0), nleaf(1), nxleaf(0), unclassified(false),
-      uploaded(false), otu(false) {
-  children.reserve(2);
-};
+    : name(""), id(n), length(NAN), bootstrap(NAN), depth(NAN), varsum(NAN), parent(NULL),
+      children(vn), pool(NULL), taxSize(0), taxLevel(0), nleaf(1), nxleaf(0),
+      nUpLeaf(0), unclassified(false), uploaded(false), otu(false), dirty(true), lng(0),
+      split(NO_SPLIT){};
 
 bool Node::isLeaf() { return children.empty(); };
 
@@ -57,44 +171,55 @@ void Node::deleteChild(Node *nd) {
 };
 
 void Node::clear() {
-  vector<Node *> nodes;
-  getDescendants(nodes);
-  vector<Node *>::iterator iter = nodes.begin();
-  vector<Node *>::iterator iterEnd = nodes.end();
-  for (; iter != iterEnd; ++iter)
-    delete *iter;
+  // the nodes in pool are released with the pool
+  if (pool == NULL) {
+    vector<Node *> nodes;
+    getDescendants(nodes);
+    vector<Node *>::iterator iter = nodes.begin();
+    vector<Node *>::iterator iterEnd = nodes.end();
+    for (; iter != iterEnd; ++iter)
+      delete *iter;
+  }
   children.clear();
 }
 
+Node *Node::_newNode() {
+  if (pool == NULL)
+    return new Node;
+  return pool->newNode();
+};
+
+// the lineage is kept once in theLngTable for the nodes set by the lineage,
+// and the string is only made for the output
+string Node::getName() const {
+  if (!name.empty())
+    return name;
+  string str(theLngTable[lng]);
+  if (split != NO_SPLIT)
+    str.insert(split, "|");
+  return str;
+};
+
 void Node::getDescendants(vector<Node *> &nds) {
-  if (!isLeaf()) {
-    for (const auto &nd : children) {
+  preorder([&](Node *nd) {
+    if (nd != this)
       nds.emplace_back(nd);
-      (*nd).getDescendants(nds);
-    }
-  }
+  });
 };
 
 void Node::getAllNodes(vector<Node *> &nds) {
-  nds.emplace_back(this);
-  getDescendants(nds);
+  preorder([&](Node *nd) { nds.emplace_back(nd); });
 };
 
 void Node::getLeafs(vector<Node *> &nodes) {
-  if (isLeaf()) {
-    nodes.emplace_back(this);
-  } else {
-    for (const auto &nd : children)
-      nd->getLeafs(nodes);
-  }
+  forEachLeaf([&](Node *nd) { nodes.emplace_back(nd); });
 };
 
 void Node::getBranches(vector<Node *> &nodes) {
-  if (!isLeaf()) {
-    nodes.emplace_back(this);
-    for (const auto &nd : children)
-      nd->getBranches(nodes);
-  }
+  preorder([&](Node *nd) {
+    if (!nd->isLeaf())
+      nodes.emplace_back(nd);
+  });
 };
 
 void Node::swap(Node *ndx) {
@@ -118,7 +243,7 @@ void Node::swap(Node *ndx) {
  ********************************************************************************/
 void Node::annotateRootedTree() {
   // set branch lineage: type, fullname,  taxLevel
-  setAllBranches();
+  updateBranches();
 }
 
 Node *Node::rootingDirect() {
@@ -168,16 +293,18 @@ Node *Node::rootingByTaxa() {
     // rearrange the tree (still unroot tree)
     theTree = resetroot(outgrp);
     // renew the update branch
-    chgBranch->setAllBranches();
+    chgBranch->updateBranches();
 
     // find a good outgroup (the last item of children)
     // by higest rank of common lineage or longest branch length
-    size_t minComLev = nRanks(commonLineage(chgBranch->name, outgrp->name));
+    size_t minComLev =
+        theLngTable.nRanks(theLngTable.common(chgBranch->lng, outgrp->lng));
     auto outIter = theTree->children.rbegin();
     for (auto iter = theTree->children.rbegin() + 1;
          iter != theTree->children.rend(); ++iter) {
       if (*iter != chgBranch) {
-        size_t comLev = nRanks(commonLineage(chgBranch->name, (*iter)->name));
+        size_t comLev = theLngTable.nRanks(
+            theLngTable.common(chgBranch->lng, (*iter)->lng));
         if (comLev < minComLev) {
           outIter = iter;
           minComLev = comLev;
@@ -197,31 +324,43 @@ Node *Node::rootingByTaxa() {
   theTree = _forceRooting(theTree);
 
   // renew the added node and the root
-  if (!theTree->children.front()->isLeaf())
-    theTree->children.front()->_setOneBranch();
-  if (!theTree->children.back()->isLeaf())
-    theTree->children.back()->_setOneBranch();
-  theTree->_setOneBranch();
+  theTree->updateBranches();
 
   return theTree;
 };
 
+/********************************************************************************
+ * @brief the candidates of outgroup below a node: the children of the nodes
+ * whose all children are clades (leafs or nodes with new ranks), the nodes
+ * below a clade or an unclassified node are not seen.
+ *
+ * In postorder, the flags of children are on the top of a stack, each with
+ * the number of candidates before its subtree, so the candidates found
+ * below a clade or an unclassified node are dropped by the node.
+ *
+ * @param clades the candidates are appended in the order of recursion
+ * @return whether the node is a clade
+ ********************************************************************************/
 bool Node::_findOutgrpCandidates(vector<Node *> &clades) {
-  if (unclassified) {
-    return false;
-  } else if (isLeaf() || nClade() > 0) {
-    return true;
-  } else {
-    // the candidates are the nodes whose all siblings are clades
+  vector<pair<char, size_t>> flags;
+  postorder([&](Node *nd) {
+    size_t nc = nd->children.size();
+    size_t start = nc == 0 ? clades.size() : flags[flags.size() - nc].second;
     bool isCandidate(true);
-    for (auto nd : children) {
-      isCandidate = nd->_findOutgrpCandidates(clades) && isCandidate;
+    for (size_t i = flags.size() - nc; i < flags.size(); ++i)
+      isCandidate = isCandidate && flags[i].first;
+    flags.resize(flags.size() - nc);
+
+    bool isClade(false);
+    if (nd->unclassified || nd->isLeaf() || nd->nClade() > 0) {
+      clades.resize(start);
+      isClade = !nd->unclassified;
+    } else if (isCandidate) {
+      clades.insert(clades.end(), nd->children.begin(), nd->children.end());
     }
-    if (isCandidate) {
-      clades.insert(clades.end(), children.begin(), children.end());
-    }
-    return false;
-  }
+    flags.emplace_back(isClade, start);
+  });
+  return flags.back().first;
 };
 
 Node *Node::_forceRooting(Node *root) {
@@ -232,8 +371,9 @@ Node *Node::_forceRooting(Node *root) {
     return root;
   }
 
-  // add a super root
-  Node *theRoot = new Node();
+  // add a super root, the new node is dirty
+  Node *theRoot = root->_newNode();
+  root->dirty = true;
 
   // add the last child of node as the outgroup of theRoot
   // add root to the super root (theRoot)
@@ -260,7 +400,7 @@ Node *Node::_forceRooting(Node *root) {
 Node *Node::rootingByLength(const string &meth) {
   // force rooting the tree
   Node *theRoot = _forceRooting(this);
-  theRoot->_getDepth();
+  theRoot->_getAllDepth();
 
   // find all nodes as the candidate
   vector<Node *> nlist;
@@ -279,22 +419,39 @@ Node *Node::rootingByLength(const string &meth) {
 void Node::_rootingTreeByLength(const string &meth,
                                 const vector<Node *> &nlist) {
   // get the depth of nodes
-  _getDepth();
+  _getAllDepth();
+
+  // the candidates are scored on a flat snapshot of the tree in threads,
+  // and only the selected one is rearranged
+  if (meth.compare("mv") == 0)
+    _getAllVarSum();
+  FlatTree flat(this, [](Node *nd) { return !nd->otu; });
+
+  // the midpoint of the longest path is not by the candidates
+  if (meth.compare("mp") == 0) {
+    _mpTree(flat);
+    return;
+  }
+
+  unordered_map<Node *, size_t> index;
+  for (size_t i = 0; i < flat.size(); ++i)
+    index.emplace(flat.nodes[i], i);
+  vector<size_t> cand;
+  for (auto nd : nlist)
+    cand.emplace_back(index[nd]);
 
   // do the rooting
   if (meth.compare("mad") == 0) {
-    _madTree(nlist);
+    _madTree(flat, nlist, cand);
   } else if (meth.compare("mv") == 0) {
-    _mvTree(nlist);
-  } else if (meth.compare("mp") == 0) {
-    _mpTree();
+    _mvTree(flat, nlist, cand);
   } else if (meth.compare("pmr") == 0) {
-    _pmrTree(nlist);
+    _pmrTree(flat, nlist, cand);
   } else if (meth.compare("md") == 0) {
-    _mdTree(nlist);
+    _mdTree(flat, nlist, cand);
   } else {
     theInfo("Unkown rooting method: " + meth + ", use MAD instead");
-    _madTree(nlist);
+    _madTree(flat, nlist, cand);
   }
 };
 
@@ -319,10 +476,10 @@ void Node::infoTree() {
   // output the root info
   stringstream buf;
   auto iter = children.begin();
-  buf << (*iter)->name << "(" << (*iter)->nleaf << "," << (*iter)->length
+  buf << (*iter)->getName() << "(" << (*iter)->nleaf << "," << (*iter)->length
       << ")";
   for (++iter; iter != children.end(); ++iter)
-    buf << ", " << (*iter)->name << "(" << (*iter)->nleaf << ","
+    buf << ", " << (*iter)->getName() << "(" << (*iter)->nleaf << ","
         << (*iter)->length << ")";
   theInfo("The root braches are: " + buf.str());
 }
@@ -343,20 +500,16 @@ void Node::findRootCandidates(vector<Node *> &nlist, size_t otulvl) {
 }
 
 void Node::_findRootCandidates(vector<Node *> &nlist, size_t otulvl) {
-  if (isLeaf()) {
-    otu = true;
-  } else if (taxLevel < otulvl) {
-    for (auto nd : children) {
+  // the branches above the otu level with more than one leaf are expanded
+  preorder([&](Node *nd) {
+    if (nd != this)
       nlist.emplace_back(nd);
-      if (!nd->isLeaf() && nd->nleaf > 1) {
-        nd->_findRootCandidates(nlist, otulvl);
-      } else {
-        nd->otu = true;
-      }
-    }
-  } else {
-    otu = true;
-  }
+    bool expand = !nd->isLeaf() && nd->taxLevel < otulvl &&
+                  (nd == this || nd->nleaf > 1);
+    if (!expand)
+      nd->otu = true;
+    return expand;
+  });
 }
 
 vector<Node *> Node::_rearrangeOutgroup(Node *np) {
@@ -378,9 +531,15 @@ vector<Node *> Node::_rearrangeOutgroup(Node *np) {
     return move(chgNodes);
   }
 
-  // relative nodes: from parent to the origal root
+  // relative nodes: from parent to the origal root, and the other children
+  // of each node off the path, more than one for a multifurcating node
   vector<Node *> nlist;
+  vector<vector<Node *>> others;
   do {
+    others.emplace_back();
+    for (auto nd : np->parent->children)
+      if (nd != np)
+        others.back().emplace_back(nd);
     nlist.emplace_back(np->parent);
     np = np->parent;
   } while (np->parent->parent != NULL);
@@ -403,10 +562,11 @@ vector<Node *> Node::_rearrangeOutgroup(Node *np) {
 
   // reset the subroot
   if (!nlist.empty()) {
-    // clear children and add sibling as a child
-    for (auto nd : nlist) {
-      nd->children.clear();
-      nd->addChild(nd->_sibling());
+    // clear children and add the other children of its parent
+    for (size_t i = 0; i < nlist.size(); ++i) {
+      nlist[i]->children.clear();
+      for (auto nd : others[i + 1])
+        nlist[i]->addChild(nd);
     }
 
     // add parent as a child
@@ -424,12 +584,18 @@ vector<Node *> Node::_rearrangeOutgroup(Node *np) {
     rest = nlist.front();
   }
 
-  // reset the subroot
+  // reset the subroot by the other children of the parent of outgroup
   subRoot->children.clear();
-  subRoot->addChild(ogSib);
+  for (auto nd : others.front())
+    subRoot->addChild(nd);
   subRoot->addChild(rest);
   chgNodes.emplace_back(subRoot);
 
+  // the change nodes are a path from the root
+  dirty = true;
+  for (auto nd : chgNodes)
+    nd->dirty = true;
+
   return move(chgNodes);
 };
 
@@ -438,213 +604,113 @@ Node *Node::_sibling() {
                                           : parent->children.front();
 };
 
+/********************************************************************************
+ * @brief the best candidate by the scores. The first one in the list is kept
+ * for a tie, so the selection does not depend on the order of scoring.
+ *
+ * @param score the scores of candidates, NaN is never selected
+ * @param minimal the best is the minimal or the maximal
+ * @return the index of the best, or the number of candidates for none
+ ********************************************************************************/
+size_t Node::_bestCandidate(const vector<double> &score, bool minimal) {
+  size_t best = score.size();
+  for (size_t k = 0; k < score.size(); ++k) {
+    if (std::isnan(score[k]))
+      continue;
+    if (best == score.size() ||
+        (minimal ? score[k] < score[best] : score[k] > score[best]))
+      best = k;
+  }
+  return best;
+};
+
 /********************************************************************************
  * @brief get minimal ancestor deviation tree
  *
  * @param nlist
  ********************************************************************************/
-void Node::_madTree(const vector<Node *> &nlist) {
-  // find the minimal depth
-  pair<Node *, pair<double, double>> minMAD{
-      NULL, make_pair(0, numeric_limits<double>::max())};
-  for (auto nd : nlist) {
-    // rearrange the tree by set nd as the outgroup
-    _rearrangeOutgroup(nd);
-    pair<double, double> mad = getMAD();
-
-    // get max pmr
-    if (mad.second < minMAD.second.second) {
-      minMAD = make_pair(nd, mad);
-    }
-  }
-
-  // select the best tree
+void Node::_madTree(FlatTree &flat, const vector<Node *> &nlist,
+                    const vector<size_t> &cand) {
+  // the ancestor deviations of all branches by one pass on the flat tree
+  vector<pair<double, double>> allMAD;
+  flat.getMAD(allMAD);
+
+  // find the minimal ancestor deviation
+  vector<double> score;
+  for (auto i : cand)
+    score.emplace_back(allMAD[i].second);
+  size_t k = _bestCandidate(score, true);
+  if (k == score.size())
+    k = 0;
+  pair<Node *, pair<double, double>> minMAD{nlist[k], allMAD[cand[k]]};
+
+  // select the best tree, the split is in the orientation of the snapshot
   _rearrangeOutgroup(minMAD.first);
 
-  children.back()->length -= minMAD.second.first;
-  children.front()->length = minMAD.second.first;
+  double doi = minMAD.second.first;
+  children.back()->length -= doi;
+  children.front()->length = doi;
 
   theInfo("Rooting Tree by minimal ancestor deviation: " +
           to_string(minMAD.second.second));
 }
 
-pair<double, double> Node::getMAD() {
-  // get depthes of all otu
-  double mad(0);
-  vector<double> backdep;
-  children.back()->_getOTUad(backdep, mad);
-  vector<double> frontdep;
-  children.front()->_getOTUad(frontdep, mad);
-
-  // obtian the break point
-  double sumx(0);
-  double sumy(0);
-  for (auto &nda : frontdep) {
-    for (auto &ndb : backdep) {
-      double dbc = 1 / (nda + ndb);
-      double ddbc = dbc * dbc;
-      sumx += (ndb - nda) * ddbc;
-      sumy += ddbc;
-    }
-  }
-  double doi = sumx * 0.5 / sumy;
-
-  double doj2;
-  if (doi < 0) {
-    doi = 0;
-    doj2 = children.back()->length * 2;
-  } else if (doi > children.back()->length) {
-    doi = children.back()->length;
-    doj2 = 0;
-  } else {
-    doj2 = (children.back()->length - doi) * 2;
-  }
-
-  // add the sanddle ancestor deviation
-  for (auto &nda : frontdep) {
-    for (auto &ndb : backdep) {
-      double dev = (ndb - nda - doj2) / (nda + ndb);
-      mad += dev * dev;
-    }
-  }
-
-  return make_pair(doi, mad);
-}
-
-void Node::_getOTUad(vector<double> &theDepth, double &mad) {
-  if (otu) {
-    theDepth.emplace_back(depth + length);
-  } else {
-    size_t b = theDepth.size();
-    children.front()->_getOTUad(theDepth, mad);
-    size_t m = theDepth.size();
-    children.back()->_getOTUad(theDepth, mad);
-    size_t e = theDepth.size();
-
-    // add the ancestor deviation between intro OTU
-    for (size_t i = b; i < m; ++i) {
-      for (size_t j = m; j < e; ++j) {
-        double lenPath = theDepth[i] + theDepth[j];
-        if (lenPath > 0) {
-          double rbc = (theDepth[i] - theDepth[j]) / lenPath;
-          mad += rbc * rbc;
-        }
-      }
-    }
-
-    // update depth of the descendant OTU
-    for (size_t i = b; i < e; ++i) {
-      theDepth[i] += length;
-    }
-  }
-}
-
 /********************************************************************************
  * @brief get the maximal relative pairwise midpoint root tree
  *
  * @param nlist
  ********************************************************************************/
-void Node::_pmrTree(const vector<Node *> &nlist) {
-  // find the maximal relatvie pairwise
-  pair<Node *, pair<double, double>> maxPMR{
-      NULL, make_pair(0, numeric_limits<double>::min())};
-  for (auto nd : nlist) {
-    // rearrange the tree by set nd as the outgroup
-    _rearrangeOutgroup(nd);
-    pair<double, double> pmr = getPMR();
-
-    // get max pmr
-    if (pmr.second > maxPMR.second.second) {
-      maxPMR = make_pair(nd, pmr);
-    }
-  }
+void Node::_pmrTree(FlatTree &flat, const vector<Node *> &nlist,
+                    const vector<size_t> &cand) {
+  // the fractions of all branches by one pass on the flat tree
+  vector<double> allPMR;
+  flat.getPMR(allPMR);
 
-  // select the best tree
+  // find the maximal relatvie pairwise
+  vector<double> score;
+  for (auto i : cand)
+    score.emplace_back(allPMR[i]);
+  size_t k = _bestCandidate(score, false);
+  if (k == score.size())
+    k = 0;
+  pair<Node *, double> maxPMR{nlist[k], score[k]};
+
+  // select the best tree, the split is only needed by the best branch
+  double doi = flat.getPMRSplit(cand[k]);
   _rearrangeOutgroup(maxPMR.first);
-  children.back()->length -= maxPMR.second.first;
-  children.front()->length = maxPMR.second.first;
+  children.back()->length -= doi;
+  children.front()->length = doi;
 
   stringstream buf;
-  buf << fixed << setprecision(1) << maxPMR.second.second * 100 << "%";
+  buf << fixed << setprecision(1) << maxPMR.second * 100 << "%";
   theInfo("Rooting Tree by pairwise midpoint root with percent: " + buf.str());
 }
 
-pair<double, double> Node::getPMR() {
-  // get depthes of all otu
-  vector<double> backdep;
-  children.back()->_getOTUdepth(backdep);
-  vector<double> frontdep;
-  children.front()->_getOTUdepth(frontdep);
-
-  // obtian the precent of PMR
-  int nPMR(0);
-  double sum(0);
-  for (auto &nda : frontdep) {
-    for (auto &ndb : backdep) {
-      double dio = 0.5 * (ndb - nda);
-      if (dio > 0 && dio < children.back()->length) {
-        ++nPMR;
-        sum += dio;
-      }
-    }
-  }
-
-  return make_pair(sum / nPMR,
-                   double(nPMR) / (frontdep.size() * backdep.size()));
-};
-
-void Node::_getOTUdepth(vector<double> &theDepth) {
-  if (otu) {
-    theDepth.emplace_back(depth + length);
-  } else {
-    size_t i = theDepth.size();
-    for (auto nd : children) {
-      nd->_getOTUdepth(theDepth);
-    }
-
-    for (; i < theDepth.size(); ++i) {
-      theDepth[i] += length;
-    }
-  }
-}
-
 /********************************************************************************
  * @brief get the minimal depth tree with midpoint and positive length
  *
  * @param nlist
  ********************************************************************************/
-void Node::_mdTree(const vector<Node *> &nlist) {
-  // find the minimal depth
-  pair<Node *, double> mindep{NULL, numeric_limits<double>::max()};
-  pair<Node *, double> mindepPlus{NULL, numeric_limits<double>::max()};
-  for (auto nd : nlist) {
-    // rearrange the tree by set nd as the outgroup
-    vector<Node *> chgNodes = _rearrangeOutgroup(nd);
-
-    // reset the branch
-    for (auto nd : chgNodes)
-      nd->_getDepth();
-    _setLengthByMidpoint();
-
-    // get mindep
-    if (depth < mindep.second) {
-      mindep = make_pair(nd, depth);
-    }
-
-    // get mindepPlus
-    if (depth < mindepPlus.second && children.front()->length > 0 &&
-        children.back()->length > 0) {
-      mindepPlus = make_pair(nd, depth);
-    }
-  }
+void Node::_mdTree(FlatTree &flat, const vector<Node *> &nlist,
+                   const vector<size_t> &cand) {
+  // the midpoint roots of all branches by two passes on the flat tree
+  vector<MidRoot> allRoot;
+  flat.getMidRoots(allRoot);
+
+  // find the minimal depth, and that with both root branches positive
+  vector<double> score, scorePlus;
+  for (auto i : cand) {
+    score.emplace_back(allRoot[i].depth);
+    scorePlus.emplace_back(allRoot[i].inner ? allRoot[i].depth : NAN);
+  }
+  size_t k = _bestCandidate(scorePlus, true);
+  if (k == score.size())
+    k = _bestCandidate(score, true);
+  if (k == score.size())
+    k = 0;
 
   // select the best tree
-  vector<Node *> chgNodes;
-  if (mindepPlus.first == NULL) {
-    chgNodes = _rearrangeOutgroup(mindep.first);
-  } else {
-    chgNodes = _rearrangeOutgroup(mindepPlus.first);
-  }
+  vector<Node *> chgNodes = _rearrangeOutgroup(nlist[k]);
 
   // update data
   for (auto nd : chgNodes)
@@ -680,140 +746,91 @@ void Node::_setLengthByMidpoint() {
 void Node::_getDepth() {
   depth = 0;
   if (!isLeaf()) {
-    nleaf = 0;
+    size_t n = 0;
     for (auto &nd : children) {
       if (nd->isLeaf()) {
         nd->depth = 0;
         depth += nd->length;
-        nleaf++;
+        n++;
       } else {
         if (std::isnan(nd->depth))
           nd->_getDepth();
-        nleaf += nd->nleaf;
+        n += nd->nleaf;
         depth += ((nd->length + nd->depth) * nd->nleaf);
       }
     }
-    depth /= double(nleaf);
+    depth /= double(n);
+
+    // the number of all leafs replaces that of the classified leafs
+    if (nleaf != n) {
+      nleaf = n;
+      _setDirty();
+    }
   }
 };
 
+// the same as _getDepth but by a sweep on the flat tree
+void Node::_getAllDepth() {
+  FlatTree flat(this, [](Node *nd) { return std::isnan(nd->depth); });
+  flat.getDepth();
+};
+
 /********************************************************************************
  * @brief rooting tree by the midpoint the longest path
  *
  ********************************************************************************/
-void Node::_mpTree() {
-  pair<double, vector<Node *>> half;
-  half.first = 0;
-  pair<double, vector<Node *>> path;
-  path.first = 0;
-  _getMaxPath(path, half);
-
-  double halfDistance = 0.5 * path.first;
-  Node *theRoot;
-  double theLength = path.second.front()->depth;
-  for (auto nd : path.second) {
-    theLength += nd->length;
-    theRoot = nd;
-    if (theLength > halfDistance)
-      break;
-  }
-
-  // reset the root
+void Node::_mpTree(FlatTree &flat) {
+  size_t i;
+  double split;
+  double maxPath = flat.getMidpoint(i, split);
+  if (i == FlatTree::NONE)
+    return;
+
+  // reset the root, the branch of root is by the outgroup and the other
+  Node *theRoot = flat.nodes[i];
   _rearrangeOutgroup(theRoot);
 
-  // reset the top branch length
-  theLength -= halfDistance;
-  if (theLength < 0) {
-    children.front()->length = children.back()->length;
-    children.back()->length = 0;
-  } else if (theLength < children.back()->length) {
-    children.front()->length = children.back()->length - theLength;
-    children.back()->length = theLength;
-  }
+  // the midpoint is at the split from the outgroup
+  Node *other =
+      children.front() == theRoot ? children.back() : children.front();
+  double lengthTotal = theRoot->length + other->length;
+  theRoot->length = split;
+  other->length = lengthTotal - split;
 
-  theInfo("Rooting Tree by midpoint of longest path: " + to_string(path.first));
-}
-
-void Node::_getMaxPath(pair<double, vector<Node *>> &maxPath,
-                       pair<double, vector<Node *>> &maxHalf) {
-
-  if (otu) {
-    maxHalf.first = depth + length;
-    maxHalf.second.emplace_back(this);
-  } else {
-    // get the max path and half path of the front brach
-    pair<double, vector<Node *>> frontHalf;
-    pair<double, vector<Node *>> frontPath;
-    children.front()->_getMaxPath(frontPath, frontHalf);
-
-    // get the max path and half path of the back brach
-    pair<double, vector<Node *>> backHalf;
-    pair<double, vector<Node *>> backPath;
-    children.back()->_getMaxPath(backPath, backHalf);
-
-    // get the max half path
-    maxHalf = frontHalf.first > backHalf.first ? frontHalf : backHalf;
-    maxHalf.first += length;
-    maxHalf.second.emplace_back(this);
-
-    // get the max path
-    double plusHalf = frontHalf.first + backHalf.first;
-    if (plusHalf > frontPath.first && plusHalf > backPath.first) {
-      maxPath.first = frontHalf.first + backHalf.first;
-      maxPath.second = frontHalf.second;
-      maxPath.second.insert(maxPath.second.end(), backHalf.second.rbegin(),
-                            backHalf.second.rend());
-    } else {
-      maxPath = frontPath.first > backPath.first ? frontPath : backPath;
-    }
-  }
+  theInfo("Rooting Tree by midpoint of longest path: " + to_string(maxPath));
 }
 
 /********************************************************************************
  * @brief rooting tree by the minimum variation from root to leafs
  *
  ********************************************************************************/
-void Node::_mvTree(const vector<Node *> &nlist) {
-  // find the minimal depth
-  _getVarSum();
-  pair<Node *, double> minvar{NULL, numeric_limits<double>::max()};
-  pair<Node *, double> minvarPlus{NULL, numeric_limits<double>::max()};
-  for (auto nd : nlist) {
-    // rearrange the tree by set nd as the outgroup
-    vector<Node *> chgNodes = _rearrangeOutgroup(nd);
-    for (auto nd : chgNodes) {
-      nd->_getDepth();
-      nd->_getVarSum();
-    }
-    // reset the branch
-    _setLengthByMidpoint();
-    _getVarSum();
-
-    // get minvar
-    if (varsum < minvar.second) {
-      minvar = make_pair(nd, varsum);
-    }
-
-    // get minvarPlus
-    if (varsum < minvarPlus.second && children.front()->length > 0 &&
-        children.back()->length > 0) {
-      minvarPlus = make_pair(nd, varsum);
-    }
-  }
+void Node::_mvTree(FlatTree &flat, const vector<Node *> &nlist,
+                   const vector<size_t> &cand) {
+  // the midpoint roots of all branches by two passes on the flat tree
+  vector<MidRoot> allRoot;
+  flat.getMidRoots(allRoot);
+
+  // find the minimal variation, and that with both root branches positive
+  vector<double> score, scorePlus;
+  for (auto i : cand) {
+    score.emplace_back(allRoot[i].varsum);
+    scorePlus.emplace_back(allRoot[i].inner ? allRoot[i].varsum : NAN);
+  }
+  size_t k = _bestCandidate(scorePlus, true);
+  if (k == score.size())
+    k = _bestCandidate(score, true);
+  if (k == score.size())
+    k = 0;
 
   // select the best tree
-  vector<Node *> chgNodes;
-  if (minvarPlus.first == NULL) {
-    chgNodes = _rearrangeOutgroup(minvar.first);
-    varsum = minvar.second;
-  } else {
-    chgNodes = _rearrangeOutgroup(minvarPlus.first);
-    varsum = minvarPlus.second;
-  }
+  vector<Node *> chgNodes = _rearrangeOutgroup(nlist[k]);
+  varsum = score[k];
 
   // set the branch length of root children
-  for (auto nd : chgNodes)
+  for (auto nd : chgNodes) {
     nd->_getDepth();
+    nd->_getVarSum();
+  }
   _setLengthByMidpoint();
 
   theInfo("Rooting Tree by minimal variation: " + to_string(varsum / nleaf));
@@ -831,6 +848,13 @@ void Node::_getVarSum() {
     }
   }
 };
+
+// the same as _getVarSum but by a sweep on the flat tree
+void Node::_getAllVarSum() {
+  FlatTree flat(this, [](Node *nd) { return std::isnan(nd->varsum); });
+  flat.getVarSum();
+};
+
 /********************************************************************************
  * @brief reset rearrange the tree by change the outgroup for unroot tree
  *
@@ -843,7 +867,8 @@ Node *Node::resetroot(const string &str) {
   getLeafs(leafs);
   Node *outgrp = NULL;
   for (Node *nd : leafs) {
-    if (lastNameNoRank(nd->name) == str) {
+    string nm(nd->getName());
+    if (lastNameNoRankView(nm) == str) {
       outgrp = nd;
       break;
     }
@@ -874,6 +899,10 @@ Node *Node::resetroot(Node *np) {
   }
   Node *theRoot = nlist.front();
 
+  // the reversed path from the new root
+  for (auto nd : nlist)
+    nd->dirty = true;
+
   // set the outgroup as the last child
   auto iter = (*theRoot).children.rbegin();
   if ((*iter) != outgrp) {
@@ -893,54 +922,94 @@ Node *Node::resetroot(Node *np) {
  *
  * @param file
  ********************************************************************************/
-function<string(Node *)> Node::nwkname = [](Node *nd) {
-  return nd->name.substr(nd->name.find_first_of('|') + 1);
-};
+// the newick text is kept in a buffer and flushed in large blocks
+const size_t NWK_BUFSIZE(1 << 20);
 
-void Node::_outnwk(ostream &os) {
-  if (!isLeaf()) {
-    os << "(";
-    auto iter = children.begin();
-    (*iter)->_outnwk(os);
-    for (++iter; iter != children.end(); ++iter) {
-      os << ",";
-      (*iter)->_outnwk(os);
-    }
-    os << ")";
+static void nwkFlush(ostream &os, string &buf, size_t limit) {
+  if (buf.size() >= limit) {
+    os.write(buf.data(), buf.size());
+    buf.clear();
   }
+};
 
-  // output the name of node
-  string namestr = nwkname(this);
-  os << ((namestr.find(' ') == string::npos) ? namestr : ('"' + namestr + '"'));
+static void nwkLabel(string &buf, string_view str) {
+  if (str.find(' ') == string_view::npos) {
+    buf.append(str);
+  } else {
+    buf.push_back('"');
+    buf.append(str);
+    buf.push_back('"');
+  }
+};
 
-  // output the length of node
-  if (!std::isnan(length))
-    os << ":" << fixed << setprecision(5) << length;
+static void nwkLength(string &buf, double length) {
+  if (!std::isnan(length)) {
+    char num[64];
+    num[0] = ':';
+    auto res = to_chars(num + 1, num + sizeof(num), length,
+                        chars_format::fixed, 5);
+    buf.append(num, res.ptr);
+  }
 };
 
-void Node::_nwk(ostream &os) {
-  if (!isLeaf()) {
-    os << "(";
-    auto iter = children.begin();
-    (*iter)->_nwk(os);
-    for (++iter; iter != children.end(); ++iter) {
-      os << ",";
-      (*iter)->_nwk(os);
+void Node::_nwkLabel(string &buf, NwkLabel label) {
+  if (label == NWK_ANNOTATED) {
+    // the lineage without the part of the upper nodes
+    if (name.empty()) {
+      string_view str(theLngTable[lng]);
+      nwkLabel(buf, split == NO_SPLIT ? str : str.substr(split));
+    } else {
+      string_view str(name);
+      size_t pos = str.find_first_of('|');
+      nwkLabel(buf, pos == string_view::npos ? str : str.substr(pos + 1));
+    }
+  } else if (label == NWK_LEAFNAME) {
+    if (isLeaf()) {
+      string nm(getName());
+      string_view str(nm);
+      size_t pos = str.find_last_of(TaxaRank::mark.second);
+      nwkLabel(buf, pos == string_view::npos ? str : str.substr(pos + 1));
     }
-    os << ")";
   } else {
-    // output the name of node
-    string namestr = lastNameNoRank(name);
-    os << ((namestr.find(' ') == string::npos) ? namestr : ('"' + namestr + '"'));
+    // the node id for itol
+    char num[32];
+    char *p = num;
+    if (!isLeaf())
+      *p++ = 'I';
+    p = to_chars(p, num + sizeof(num), id).ptr;
+    buf.append(num, p);
   }
+};
 
-  // output the length of node
-  if (!std::isnan(length))
-    os << ":" << fixed << setprecision(5) << length;
+void Node::_outnwk(ostream &os, NwkLabel label) {
+  string buf;
+  buf.reserve(NWK_BUFSIZE + NWK_BUFSIZE / 4);
+
+  // depth first without recursion, the node and its next child
+  vector<pair<Node *, size_t>> stack;
+  stack.emplace_back(this, 0);
+  while (!stack.empty()) {
+    Node *nd = stack.back().first;
+    size_t i = stack.back().second;
+    if (i < nd->children.size()) {
+      buf.push_back(i == 0 ? '(' : ',');
+      stack.back().second++;
+      stack.emplace_back(nd->children[i], 0);
+    } else {
+      if (!nd->isLeaf())
+        buf.push_back(')');
+      nd->_nwkLabel(buf, label);
+      nwkLength(buf, nd->length);
+      nwkFlush(os, buf, NWK_BUFSIZE);
+      stack.pop_back();
+    }
+  }
+  buf.append(";\n");
+  nwkFlush(os, buf, 0);
 };
 
 void Node::outnwk(const string &file, bool annotated) {
-  ofstream os(file);
+  ogzstream os(file);
   if (!os) {
     cerr << "Open " << file << " for write failed" << endl;
     exit(3);
@@ -960,151 +1029,466 @@ void Node::outitol(const string &file) {
   // output the taxid
   int theId = 0;
   updateId(theId);
-  nwkname = [](Node *nd) {
-    if (nd->isLeaf()) {
-      return to_string(nd->id);
-    } else {
-      return "I" + to_string(nd->id);
-    }
-  };
-
-  outnwk(os);
+  _outnwk(os, NWK_ITOL);
   os.close();
 };
 
 void Node::outnwk(ostream &os, bool annotated) {
-  if (annotated) {
-    _outnwk(os);
+  _outnwk(os, annotated ? NWK_ANNOTATED : NWK_LEAFNAME);
+  os.flush();
+};
+
+// characters omitted from the labels of newick file
+static bool nwkOmit(char c) {
+  return c == '"' || c == '\'' || c == '\n' || c == '\t' || c == '\r';
+};
+
+// read a number at the begin of the slice, return NULL if failed
+static const char *nwkNumber(const char *b, const char *e, double &v) {
+  while (b != e && (*b == ' ' || nwkOmit(*b)))
+    ++b;
+  if (b != e && *b == '+')
+    ++b;
+  auto res = from_chars(b, e, v);
+  return res.ec == errc() ? res.ptr : NULL;
+};
+
+void Node::_nwkItem(const char *b, const char *e, bool branch) {
+  // the item is in form of label:length[support]
+  string_view item(b, e - b);
+  size_t pos = item.find_first_of(":[");
+  string_view label = item.substr(0, pos);
+  while (pos != string_view::npos) {
+    if (item[pos] == ':') {
+      nwkNumber(b + pos + 1, e, length);
+      pos = item.find('[', pos + 1);
+    } else {
+      size_t rpos = item.find(']', pos);
+      if (rpos == string_view::npos)
+        rpos = item.size();
+      double v;
+      if (nwkNumber(b + pos + 1, b + rpos, v) == b + rpos)
+        bootstrap = v;
+      pos = item.find_first_of(":[", rpos);
+    }
+  }
+
+  // trim the label
+  while (!label.empty() && (label.front() == ' ' || nwkOmit(label.front())))
+    label.remove_prefix(1);
+  while (!label.empty() && (label.back() == ' ' || nwkOmit(label.back())))
+    label.remove_suffix(1);
+  if (label.empty())
+    return;
+
+  // the label of branch may be the support value
+  if (branch) {
+    double v;
+    const char *lend = label.data() + label.size();
+    if (nwkNumber(label.data(), lend, v) == lend) {
+      bootstrap = v;
+      return;
+    }
+  }
+
+  if (label.find_first_of("\"'\n\t\r") == string_view::npos) {
+    name.assign(label);
   } else {
-    _nwk(os);
+    name.clear();
+    for (char c : label) {
+      if (!nwkOmit(c))
+        name.push_back(c);
+    }
   }
-  os << ";" << endl;
 };
 
-void Node::_nwkItem(const string &str) {
-  vector<string> words;
-  separateWord(words, str, ":");
-  if (isLeaf()) {
-    name = words.front();
-  } else {
-    try {
-      bootstrap = str2double(words.front());
-    } catch (exception e) {
-      name = words.front();
+// find the largest subtrees smaller than the grain for parsing in parallel
+static void nwkSubtrees(const char *beg, const char *end, size_t grain,
+                        vector<NwkSubtree> &subs) {
+  // the begin of opened subtree and the number of subtrees found before it
+  vector<pair<const char *, size_t>> opened;
+  for (const char *p = beg; p != end; ++p) {
+    if (*p == '(') {
+      opened.emplace_back(p + 1, subs.size());
+    } else if (*p == ')') {
+      if (opened.empty())
+        return;
+      auto op = opened.back();
+      opened.pop_back();
+      if (opened.empty())
+        return;
+      if (size_t(p - op.first) <= grain) {
+        subs.resize(op.second);
+        subs.push_back({op.first, p, NULL});
+      }
+    } else if (*p == '[') {
+      p = find(p, end, ']');
+      if (p == end)
+        return;
+    } else if (*p == ';') {
+      return;
     }
   }
-  length = str2double(words.back());
 };
 
-void Node::_innwk(istream &is) {
-  Node *np = new Node;
+const char *Node::_innwk(const char *beg, const char *end,
+                         vector<NwkSubtree> &subs) {
+  // the nodes with open parenthesis
+  vector<Node *> opened{this};
+  Node *np = _newNode();
   addChild(np);
-  string brStr;
-
-  while (is.good()) {
-    char c = is.get();
-    if (c == ',') {
-      if (!brStr.empty()) {
-        np->_nwkItem(brStr);
-        brStr.clear();
-      }
+  const char *item = beg;
+  bool branch(false);
+  auto sub = subs.begin();
 
-      np = new Node;
-      addChild(np);
-    } else if (c == ')') {
-      if (!brStr.empty()) {
-        np->_nwkItem(brStr);
-        brStr.clear();
+  for (const char *p = beg; p != end; ++p) {
+    char c = *p;
+    if (c == '(') {
+      if (sub != subs.end() && sub->beg == p + 1) {
+        // leave the subtree for parsing in parallel
+        sub->node = np;
+        p = sub->end;
+        ++sub;
+        branch = true;
+      } else {
+        opened.emplace_back(np);
+        np = _newNode();
+        opened.back()->addChild(np);
       }
+      item = p + 1;
+    } else if (c == ',' || c == ')') {
+      np->_nwkItem(item, p, branch);
+      if (c == ',') {
+        np = _newNode();
+        opened.back()->addChild(np);
+        branch = false;
+      } else {
+        np = opened.back();
+        opened.pop_back();
+        if (opened.empty())
+          return p;
+        branch = true;
+      }
+      item = p + 1;
+    } else if (c == '[') {
+      // skip the comment/support in bracket
+      p = find(p, end, ']');
+      if (p == end)
+        break;
+    } else if (c == ';') {
       break;
-    } else if (c == '(') {
-      np->_innwk(is);
-    } else if (c != '"' && c != '\n' && c != '\t' && c != '\'') {
-      brStr.push_back(c);
     }
   }
-};
 
-void Node::innwk(istream &is) {
+  cerr << "some wrong in the nwk file" << endl;
+  exit(1);
+};
 
-  char c = is.get();
-  string brStr;
-  while (c != ';') {
-    if (c == '(') {
-      _innwk(is);
-    } else if (c != '"' && c != '\n' && c != '\t' && c != '\'') {
-      brStr.push_back(c);
+const char *Node::innwk(const char *beg, const char *end, bool inParallel) {
+  for (const char *p = beg; p != end; ++p) {
+    if (*p == '(') {
+      // split the large tree into subtrees for threads
+      vector<NwkSubtree> subs;
+      int nthread = nThreads();
+      if (inParallel && nthread > 1 && size_t(end - p) > NWK_PARALLEL_SIZE)
+        nwkSubtrees(p, end, (end - p) / (8 * nthread), subs);
+
+      // parse the backbone and then the subtrees
+      p = _innwk(p + 1, end, subs);
+#pragma omp parallel for schedule(dynamic)
+      for (size_t i = 0; i < subs.size(); ++i) {
+        vector<NwkSubtree> none;
+        subs[i].node->_innwk(subs[i].beg, subs[i].end + 1, none);
+      }
+    } else if (*p == '[') {
+      p = find(p, end, ']');
+      if (p == end)
+        break;
+    } else if (*p == ';') {
+      return p + 1;
     }
+  }
 
-    if (is.good()) {
-      c = is.get();
-    } else {
-      cerr << "some wrong in the nwk file" << endl;
-      exit(1);
+  cerr << "some wrong in the nwk file" << endl;
+  exit(1);
+};
+
+size_t splitNwk(const char *beg, const char *end,
+                vector<pair<const char *, const char *>> &trees) {
+  const char *b = beg;
+  for (const char *p = beg; p != end; ++p) {
+    if (*p == '[') {
+      p = find(p, end, ']');
+      if (p == end)
+        break;
+    } else if (*p == ';') {
+      trees.emplace_back(b, p + 1);
+      b = p + 1;
     }
   }
+
+  // keep the unfinished tail for the error report
+  if (find_if(b, end, [](unsigned char c) { return !isspace(c); }) != end)
+    trees.emplace_back(b, end);
+  return trees.size();
+};
+
+void Node::innwk(istream &is) {
+  // read one tree terminated by semicolon
+  string str;
+  getline(is, str, ';');
+  if (is.eof()) {
+    cerr << "some wrong in the nwk file" << endl;
+    exit(1);
+  }
+  str.push_back(';');
+  innwk(str.data(), str.data() + str.size());
 };
 
-void Node::innwk(const string &file) {
-  ifstream inwk(file);
-  if (!inwk) {
+void Node::innwk(const string &file, bool inParallel) {
+  MapFile nwk(file);
+  if (!nwk.good()) {
     cerr << "Cannot found the input newick file " << file << endl;
     exit(4);
   }
 
-  innwk(inwk);
-  inwk.close();
+  innwk(nwk.begin(), nwk.end(), inParallel);
 }
 
-void Node::checkUnclassified() {
-  if (isLeaf()) {
-    if (unclassified) {
-      nleaf = 0;
-      nxleaf = 1;
+void Node::checkUnclassified() { FlatTree(this).checkUnclassified(); };
+
+void Node::checkUploaded() {
+  postorder([](Node *nd) {
+    if (nd->isLeaf()) {
+      if (nd->getName().find(".UPLOAD") != string::npos) {
+        nd->nUpLeaf = 1;
+        nd->uploaded = true;
+      }
     } else {
-      nleaf = 1;
-      nxleaf = 0;
-    }
-  } else {
-    nxleaf = 0;
-    nleaf = 0;
-    for (const auto &nd : children) {
-      nd->checkUnclassified();
-      nxleaf += nd->nxleaf;
-      nleaf += nd->nleaf;
+      bool isUpload = true;
+      for (const auto &child : nd->children) {
+        nd->nUpLeaf += child->nUpLeaf;
+        isUpload = isUpload && child->uploaded;
+      }
+      nd->uploaded = isUpload;
     }
+  });
+};
+
+void Node::getDefineLeafs(vector<Node *> &nodes) {
+  forEachLeaf([&](Node *nd) {
+    if (!nd->unclassified)
+      nodes.emplace_back(nd);
+  });
+};
+
+/********************************************************************************
+ * @brief the binary tree format, the arrays are aligned by 8 bytes for
+ * reading from the memory map directly
+ *
+ * @param file
+ ********************************************************************************/
+static size_t binAlign(size_t n) { return (n + 7) & ~size_t(7); };
+
+template <typename C> static void binArray(ostream &os, const C &v) {
+  size_t n = v.size() * sizeof(typename C::value_type);
+  os.write((const char *)v.data(), n);
+  os.write("\0\0\0\0\0\0\0", binAlign(n) - n);
+};
+
+// the size n is from the file, it is checked before any pointer arithmetic
+template <typename T>
+static const T *binArray(const char *&p, const char *end, size_t n) {
+  size_t rest = end - p;
+  if (n > rest / sizeof(T) || binAlign(n * sizeof(T)) > rest) {
+    cerr << "The binary tree file is truncated" << endl;
+    exit(4);
   }
+  const T *v = (const T *)p;
+  p += binAlign(n * sizeof(T));
+  return v;
+};
 
-  if (nleaf == 0) {
-    unclassified = true;
+bool isBinTree(const char *beg, const char *end) {
+  return size_t(end - beg) >= sizeof(BinTreeHead) &&
+         memcmp(beg, BINTREE_MAGIC, sizeof(BINTREE_MAGIC)) == 0;
+};
+
+void Node::outbin(ostream &os) {
+  vector<Node *> nodes;
+  getAllNodes(nodes);
+  size_t n = nodes.size();
+
+  // the parent index and the string table of names
+  unordered_map<Node *, int64_t> index;
+  unordered_map<string, uint32_t> strIndex;
+  vector<int64_t> parents(n, -1);
+  vector<uint32_t> names(n);
+  vector<uint64_t> offsets(1, 0);
+  string strs;
+  for (size_t i = 0; i < n; ++i) {
+    Node *nd = nodes[i];
+    index[nd] = i;
+    if (i > 0)
+      parents[i] = index[nd->parent];
+
+    string nm(nd->getName());
+    auto iter = strIndex.find(nm);
+    if (iter == strIndex.end()) {
+      strs += nm;
+      iter = strIndex.emplace(move(nm), offsets.size() - 1).first;
+      offsets.emplace_back(strs.size());
+    }
+    names[i] = iter->second;
+  }
+
+  // the hot fields of nodes
+  vector<uint64_t> ids(n), taxSizes(n), taxLevels(n), nleafs(n), nxleafs(n);
+  vector<double> lengths(n), bootstraps(n);
+  vector<uint8_t> flags(n);
+  for (size_t i = 0; i < n; ++i) {
+    Node *nd = nodes[i];
+    ids[i] = nd->id;
+    lengths[i] = nd->length;
+    bootstraps[i] = nd->bootstrap;
+    taxSizes[i] = nd->taxSize;
+    taxLevels[i] = nd->taxLevel;
+    nleafs[i] = nd->nleaf;
+    nxleafs[i] = nd->nxleaf;
+    flags[i] = nd->unclassified | (nd->uploaded << 1) | (nd->otu << 2);
+  }
+
+  BinTreeHead head;
+  memcpy(head.magic, BINTREE_MAGIC, sizeof(BINTREE_MAGIC));
+  head.version = BINTREE_VERSION;
+  head.nNode = n;
+  head.nStr = offsets.size() - 1;
+  head.strSize = strs.size();
+  os.write((const char *)&head, sizeof(head));
+
+  binArray(os, parents);
+  binArray(os, ids);
+  binArray(os, lengths);
+  binArray(os, bootstraps);
+  binArray(os, taxSizes);
+  binArray(os, taxLevels);
+  binArray(os, nleafs);
+  binArray(os, nxleafs);
+  binArray(os, names);
+  binArray(os, flags);
+  binArray(os, offsets);
+  binArray(os, strs);
+};
+
+void Node::outbin(const string &file) {
+  ogzstream os(file);
+  if (!os) {
+    cerr << "Open " << file << " for write failed" << endl;
+    exit(3);
   }
+
+  outbin(os);
+  os.close();
 };
 
-void Node::checkUploaded() {
-  if (isLeaf()) {
-    if (name.find(".UPLOAD") != string::npos) {
-      nUpLeaf = 1;
-      uploaded = true;
+void Node::inbin(const char *beg, const char *end) {
+  if (!isBinTree(beg, end)) {
+    cerr << "It is not a binary tree file" << endl;
+    exit(4);
+  }
+
+  BinTreeHead head;
+  memcpy(&head, beg, sizeof(head));
+  if (head.version != BINTREE_VERSION) {
+    cerr << "Unsupported version of binary tree file: " << head.version
+         << endl;
+    exit(4);
+  }
+
+  // a valid tree has one node at least, and no more names than nodes
+  if (head.nNode == 0 || head.nStr > head.nNode) {
+    cerr << "some wrong in the binary tree file" << endl;
+    exit(4);
+  }
+
+  size_t n = head.nNode;
+  const char *p = beg + sizeof(head);
+  auto parents = binArray<int64_t>(p, end, n);
+  auto ids = binArray<uint64_t>(p, end, n);
+  auto lengths = binArray<double>(p, end, n);
+  auto bootstraps = binArray<double>(p, end, n);
+  auto taxSizes = binArray<uint64_t>(p, end, n);
+  auto taxLevels = binArray<uint64_t>(p, end, n);
+  auto nleafs = binArray<uint64_t>(p, end, n);
+  auto nxleafs = binArray<uint64_t>(p, end, n);
+  auto names = binArray<uint32_t>(p, end, n);
+  auto flags = binArray<uint8_t>(p, end, n);
+  auto offsets = binArray<uint64_t>(p, end, head.nStr + 1);
+  const char *strs = binArray<char>(p, end, head.strSize);
+
+  // the offsets of names are ascending in the string table
+  bool goodStr = offsets[0] == 0 && offsets[head.nStr] == head.strSize;
+  for (size_t i = 0; goodStr && i < head.nStr; ++i)
+    goodStr = offsets[i] <= offsets[i + 1];
+  if (!goodStr) {
+    cerr << "some wrong in the binary tree file" << endl;
+    exit(4);
+  }
+
+  // rebuild the nodes in preorder, the parent is before its children
+  vector<Node *> nodes(n);
+  for (size_t i = 0; i < n; ++i) {
+    Node *nd = (i == 0) ? this : _newNode();
+    nodes[i] = nd;
+    if (i > 0) {
+      if (parents[i] < 0 || size_t(parents[i]) >= i) {
+        cerr << "some wrong in the binary tree file" << endl;
+        exit(1);
+      }
+      nodes[parents[i]]->addChild(nd);
     }
-  } else {
-    bool isUpload = true;
-    for (const auto &nd : children) {
-      (*nd).checkUploaded();
-      nUpLeaf += (*nd).nUpLeaf;
-      isUpload = isUpload && (*nd).uploaded;
+    if (names[i] >= head.nStr) {
+      cerr << "some wrong in the binary tree file" << endl;
+      exit(1);
     }
-    uploaded = isUpload;
+
+    nd->id = ids[i];
+    nd->name.assign(strs + offsets[names[i]],
+                    offsets[names[i] + 1] - offsets[names[i]]);
+    nd->length = lengths[i];
+    nd->bootstrap = bootstraps[i];
+    nd->taxSize = taxSizes[i];
+    nd->taxLevel = taxLevels[i];
+    nd->nleaf = nleafs[i];
+    nd->nxleaf = nxleafs[i];
+    nd->unclassified = flags[i] & 1;
+    nd->uploaded = flags[i] & 2;
+    nd->otu = flags[i] & 4;
   }
 };
 
-void Node::getDefineLeafs(vector<Node *> &nodes) {
-  if (isLeaf()) {
-    if (!unclassified)
-      nodes.emplace_back(this);
-  } else {
-    for (const auto &nd : children)
-      (*nd).getDefineLeafs(nodes);
+void Node::inbin(const string &file) {
+  MapFile bin(file);
+  if (!bin.good()) {
+    cerr << "Cannot found the input binary tree file " << file << endl;
+    exit(4);
   }
+
+  inbin(bin.begin(), bin.end());
+};
+
+// read tree in the binary format or newick format
+void Node::intree(const string &file, bool inParallel) {
+  MapFile tree(file);
+  if (!tree.good()) {
+    cerr << "Cannot found the input tree file " << file << endl;
+    exit(4);
+  }
+
+  if (isBinTree(tree.begin(), tree.end()))
+    inbin(tree.begin(), tree.end());
+  else
+    innwk(tree.begin(), tree.end(), inParallel);
 };
 
 /********************************************************************************
@@ -1114,7 +1498,7 @@ void Node::getDefineLeafs(vector<Node *> &nodes) {
  ********************************************************************************/
 
 void Node::injson(const string &file) {
-  ifstream ijson(file.c_str());
+  igzstream ijson(file);
   if (!ijson) {
     cerr << " Cannot found the input file " << file << endl;
     exit(4);
@@ -1127,30 +1511,41 @@ void Node::injson(istream &is) {
   _injson(is);
 };
 
+// the nodes are read without recursion, each open node keeps its key and
+// value on the stack until its end
 void Node::_injson(istream &is) {
-  char c = is.get();
-  bool isValue(false);
-  string key, value;
-  while (c != '}') {
+  struct JsonItem {
+    Node *nd;
+    string key, value;
+    bool isValue;
+  };
+  vector<JsonItem> stack{{this, "", "", false}};
+  while (!stack.empty()) {
+    int c = is.get();
+    if (c == EOF)
+      break;
+
+    JsonItem &item = stack.back();
     if (c == '"') {
-      if (isValue)
-        _getStr(is, value);
+      if (item.isValue)
+        _getStr(is, item.value);
       else
-        _getStr(is, key);
+        _getStr(is, item.key);
     } else if (c == ':') {
-      isValue = true;
+      item.isValue = true;
     } else if (c == '{') {
-      Node *nd = new Node;
-      addChild(nd);
-      (*nd)._injson(is);
-    } else if (c == ',' && isValue) {
-      _getKeyValue(key, value);
-      isValue = false;
+      Node *nd = item.nd->_newNode();
+      item.nd->addChild(nd);
+      stack.push_back({nd, "", "", false});
+    } else if (c == ',' && item.isValue) {
+      item.nd->_getKeyValue(item.key, item.value);
+      item.isValue = false;
+    } else if (c == '}') {
+      if (item.isValue)
+        item.nd->_getKeyValue(item.key, item.value);
+      stack.pop_back();
     }
-    c = is.get();
   }
-  if (isValue)
-    _getKeyValue(key, value);
 };
 
 void Node::_getKeyValue(string &key, string &value) {
@@ -1200,7 +1595,7 @@ void Node::_getStr(istream &is, string &str) {
 };
 
 void Node::outjson(const string &file) {
-  ofstream os(file);
+  ogzstream os(file);
   if (!os) {
     cerr << "Open " << file << " for write failed" << endl;
     exit(3);
@@ -1210,12 +1605,49 @@ void Node::outjson(const string &file) {
   os.close();
 };
 
-void Node::outjson(ostream &os) {
+void Node::outjson(ostream &os) { _outjson(os, false); };
+
+void Node::outjsonAbbr(ostream &os) { _outjson(os, true); };
 
-  os << "{";
-  if (!name.empty()) {
+/********************************************************************************
+ * @brief the json of tree without recursion, the items of nodes are written
+ * in preorder and the list of children is closed after the last child
+ *
+ * @param abbr whether the abbreviated keys are used
+ ********************************************************************************/
+void Node::_outjson(ostream &os, bool abbr) {
+  vector<pair<Node *, size_t>> stack{{this, 0}};
+  while (!stack.empty()) {
+    Node *nd = stack.back().first;
+    size_t i = stack.back().second++;
+    if (i == 0) {
+      os << "{";
+      if (abbr)
+        nd->_jsonAbbrItem(os);
+      else
+        nd->_jsonItem(os);
+      if (!nd->isLeaf())
+        os << (abbr ? ",\"c\":[" : ",\"children\":[");
+    }
+
+    if (i < nd->children.size()) {
+      if (i > 0)
+        os << ",";
+      stack.emplace_back(nd->children[i], 0);
+    } else {
+      if (!nd->isLeaf())
+        os << "]";
+      os << "}";
+      stack.pop_back();
+    }
+  }
+};
+
+void Node::_jsonItem(ostream &os) {
+  string nm(getName());
+  if (!nm.empty()) {
     os << '"' << "name"
-       << "\":\"" << name << "{" << nleaf;
+       << "\":\"" << nm << "{" << nleaf;
     if (nleaf > 0 && nleaf < taxSize)
       os << "/" << taxSize;
     if (nxleaf != 0) {
@@ -1249,27 +1681,13 @@ void Node::outjson(ostream &os) {
   if (!std::isnan(length))
     os << ',' << '"' << "length"
        << "\":\"" << fixed << setprecision(5) << length << '"';
-
-  if (!isLeaf()) {
-    os << ",\"children\":[";
-
-    Children::const_iterator iter = children.begin();
-    (*(*iter)).outjson(os);
-    for (++iter; iter != children.end(); ++iter) {
-      os << ",";
-      (*(*iter)).outjson(os);
-    }
-    os << "]";
-  }
-  os << "}";
 };
 
-void Node::outjsonAbbr(ostream &os) {
-
-  os << "{";
-  if (!name.empty()) {
+void Node::_jsonAbbrItem(ostream &os) {
+  string nm(getName());
+  if (!nm.empty()) {
     os << '"' << "n"
-       << "\":\"" << name << "{" << nleaf;
+       << "\":\"" << nm << "{" << nleaf;
     if (nleaf < taxSize)
       os << "/" << taxSize;
     if (nxleaf != 0) {
@@ -1303,36 +1721,14 @@ void Node::outjsonAbbr(ostream &os) {
   // if(!isnan(length))
   // 	os << ',' << '"' << "l" << "\":\"" << fixed << setprecision(5) << length
   // <<'"';
-
-  if (!isLeaf()) {
-    os << ",\"c\":[";
-
-    Children::const_iterator iter = children.begin();
-    (*(*iter)).outjsonAbbr(os);
-    for (++iter; iter != children.end(); ++iter) {
-      os << ",";
-      (*(*iter)).outjsonAbbr(os);
-    }
-    os << "]";
-  }
-  os << "}";
 };
 
 void Node::renewId(const unordered_map<string, size_t> &mgi) {
-  if (isLeaf()) {
-    id = mgi.find(name)->second;
-  } else {
-    for (auto &nd : children)
-      (*nd).renewId(mgi);
-  }
+  forEachLeaf([&](Node *nd) { nd->id = mgi.find(nd->getName())->second; });
 };
 
 void Node::updateId(int &theId) {
-  id = ++theId;
-  if (!isLeaf()) {
-    for (auto &nd : children)
-      (*nd).updateId(theId);
-  }
+  preorder([&](Node *nd) { nd->id = ++theId; });
 };
 
 /********************************************************************************
@@ -1359,56 +1755,47 @@ void Node::outPrediction(ostream &os) {
       string p;
       (*nd)._getPrediction(p);
       p.erase(remove(p.begin(), p.end(), '|'), p.end());
-      os << lastNameNoRank(nd->name) << "\t" << p << endl;
+      os << lastNameNoRankView(nd->getName()) << "\t" << p << endl;
     }
   }
 };
 
+// the name of the lowest ancestor coinciding with its taxon, or the root
 void Node::_getPrediction(string &p) {
-  if (parent == NULL) {
-    p = name;
-  } else {
-    if ((*parent).nleaf == (*parent).taxSize) {
-      p = (*parent).name;
-    } else {
-      (*parent)._getPrediction(p);
-    }
-  }
+  Node *nd = this;
+  while (nd->parent != NULL && nd->parent->nleaf != nd->parent->taxSize)
+    nd = nd->parent;
+  p = nd->parent == NULL ? nd->getName() : nd->parent->getName();
 };
 
 void Node::reinitTree() {
-  if (isLeaf()) {
-    name.erase(name.find('|'), 1);
-  } else {
-    name = "";
-    for (const auto &nd : children)
-      (*nd).reinitTree();
-  }
+  preorder([](Node *nd) {
+    nd->split = NO_SPLIT;
+    if (!nd->isLeaf()) {
+      nd->name.clear();
+      nd->lng = 0;
+      nd->dirty = true;
+    }
 
-  nxleaf = 0;
-  nleaf = 0;
-  taxSize = 0;
-  unclassified = false;
+    nd->nxleaf = 0;
+    nd->nleaf = 0;
+    nd->taxSize = 0;
+    nd->unclassified = false;
+  });
 }
 
 void Node::getUndefineLeafs(vector<Node *> &nodes) {
-  if (children.empty()) {
-    if (unclassified)
-      nodes.emplace_back(this);
-  } else {
-    for (auto nd : children)
-      (*nd).getUndefineLeafs(nodes);
-  }
+  forEachLeaf([&](Node *nd) {
+    if (nd->unclassified)
+      nodes.emplace_back(nd);
+  });
 };
 
 void Node::getUndefineNames(vector<string> &names) {
-  if (children.empty()) {
-    if (unclassified)
-      names.emplace_back(name);
-  } else {
-    for (auto nd : children)
-      (*nd).getUndefineNames(names);
-  }
+  forEachLeaf([&](Node *nd) {
+    if (nd->unclassified)
+      names.emplace_back(nd->getName());
+  });
 };
 
 /********************************************************************************
@@ -1425,8 +1812,11 @@ void Node::setOneLeaf(const string &nm, bool def) {
     nxleaf = 1;
     unclassified = true;
   }
-  name = nm;
-  taxLevel = nRanks(nm);
+  lng = theLngTable.intern(nm);
+  name.clear();
+  split = NO_SPLIT;
+  taxLevel = theLngTable.nRanks(lng);
+  dirty = false;
 };
 
 void Node::_setOneBranch() {
@@ -1445,28 +1835,54 @@ void Node::_setOneBranch() {
     }
   }
 
-  // set unclassified and name
+  // set unclassified and lineage
   if (nleaf == 0) {
     // for unclassified node
     unclassified = true;
-    name = _getBranchName(undefNode);
+    lng = _getBranchLng(undefNode);
   } else {
     // for defined node
-    name = _getBranchName(defNode);
+    lng = _getBranchLng(defNode);
   }
 
-  // set tax level
-  taxLevel = nRanks(name);
+  // the name is by the lineage, set tax level
+  name.clear();
+  split = NO_SPLIT;
+  taxLevel = theLngTable.nRanks(lng);
+  dirty = false;
 }
 
 void Node::setAllBranches() {
-  if (!isLeaf()) {
-    for (auto &child : children)
-      child->setAllBranches();
-    _setOneBranch();
+  // from leafs to root on the flat tree
+  FlatTree flat(this);
+  for (size_t i = flat.size(); i-- > 0;) {
+    if (!flat.leaf[i])
+      flat.nodes[i]->_setOneBranch();
   }
 }
 
+// renew the dirty branches only, the clean nodes keep their subtrees
+void Node::updateBranches() {
+  vector<Node *> nodes;
+  preorder([&nodes](Node *nd) {
+    if (nd->isLeaf() || !nd->dirty)
+      return false;
+    nodes.emplace_back(nd);
+    return true;
+  });
+
+  // from leafs to root
+  for (auto iter = nodes.rbegin(); iter != nodes.rend(); ++iter)
+    (*iter)->_setOneBranch();
+}
+
+// mark the node and its ancestors after changing the subtree
+void Node::_setDirty() {
+  dirty = true;
+  for (Node *nd = parent; nd != NULL && !nd->dirty; nd = nd->parent)
+    nd->dirty = true;
+}
+
 void Node::setBranchLineage() {
   if (!isLeaf()) {
     vector<Node *> defNode;
@@ -1482,30 +1898,29 @@ void Node::setBranchLineage() {
     }
 
     if (defNode.size() > 0) {
-      name = _getBranchName(defNode);
+      lng = _getBranchLng(defNode);
     } else {
-      name = _getBranchName(undefNode);
+      lng = _getBranchLng(undefNode);
     }
+    name.clear();
+    split = NO_SPLIT;
+    dirty = false;
   }
 
   // set tax level
-  taxLevel = nRanks(name);
+  taxLevel = theLngTable.nRanks(lng);
 };
 
-string Node::_getBranchName(const vector<Node *> &nds) {
-  string nodeName;
-  if (nds.size() == 1) {
-    nodeName = delStrain(nds.front()->name);
-  } else {
-    auto iter = nds.begin();
-    nodeName = (*iter++)->name;
-    do {
-      string lngB = (*iter++)->name;
-      nodeName = commonLineage(nodeName, lngB);
-    } while (iter != nds.end());
-  }
+uint32_t Node::_getBranchLng(const vector<Node *> &nds) {
+  if (nds.size() == 1)
+    return theLngTable.noStrain(nds.front()->lng);
 
-  return nodeName;
+  auto iter = nds.begin();
+  uint32_t id = (*iter++)->lng;
+  do {
+    id = theLngTable.common(id, (*iter++)->lng);
+  } while (iter != nds.end());
+  return id;
 };
 
 int Node::nClade() {
@@ -14,13 +14,20 @@
 #define TREE_H
 
 #include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <set>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -30,9 +37,100 @@ using namespace std;
 
 typedef pair<string, string> str2str;
 
-struct Node {
-  typedef vector<Node *> Children;
+// a subtree in the newick text, i.e. the text in the parentheses
+struct Node;
+struct FlatTree;
+struct NwkSubtree {
+  const char *beg, *end;
+  Node *node;
+};
+
+// the label of nodes in newick output: the annotated lineage, the name of
+// leafs only, or the node id for itol
+enum NwkLabel { NWK_ANNOTATED, NWK_LEAFNAME, NWK_ITOL };
+
+// the head of binary tree file, followed by the node arrays in preorder:
+// parent, id, length, bootstrap, taxSize, taxLevel, nleaf, nxleaf, name and
+// flags, and then the string table of names (offsets and characters)
+const char BINTREE_MAGIC[4] = {'C', 'L', 'T', 'B'};
+const uint32_t BINTREE_VERSION(1);
+struct BinTreeHead {
+  char magic[4];
+  uint32_t version;
+  uint64_t nNode, nStr, strSize;
+};
+
+// the lineage of node is not split by the annotation
+const uint32_t NO_SPLIT(numeric_limits<uint32_t>::max());
+
+// the number of children kept in the node without heap allocation
+const size_t N_FORKS(2);
+
+// the children of node, a small vector with the first N_FORKS children in
+// place, so a bifurcating tree has no extra heap block per node
+class Children {
+public:
+  typedef Node *value_type;
+  typedef Node **iterator;
+  typedef Node *const *const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+
+  Children() : ptr(local), nsize(0), ncap(N_FORKS){};
+  Children(const vector<Node *> &);
+  Children(const Children &);
+  Children &operator=(const Children &);
+  ~Children();
+
+  iterator begin() { return ptr; };
+  iterator end() { return ptr + nsize; };
+  const_iterator begin() const { return ptr; };
+  const_iterator end() const { return ptr + nsize; };
+  reverse_iterator rbegin() { return reverse_iterator(end()); };
+  reverse_iterator rend() { return reverse_iterator(begin()); };
 
+  size_t size() const { return nsize; };
+  bool empty() const { return nsize == 0; };
+  Node *&operator[](size_t i) { return ptr[i]; };
+  Node *operator[](size_t i) const { return ptr[i]; };
+  Node *&front() { return ptr[0]; };
+  Node *&back() { return ptr[nsize - 1]; };
+  Node *front() const { return ptr[0]; };
+  Node *back() const { return ptr[nsize - 1]; };
+
+  void reserve(size_t);
+  void emplace_back(Node *);
+  void pop_back() { --nsize; };
+  iterator erase(iterator);
+  void clear() { nsize = 0; };
+
+private:
+  Node **ptr;
+  size_t nsize, ncap;
+  Node *local[N_FORKS];
+};
+
+// the slabs of nodes for trees, the nodes are allocated in blocks by each
+// thread and all of them are released together with the pool
+struct NodePool {
+  NodePool();
+  ~NodePool();
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  Node *newNode();
+  size_t size() const;
+
+private:
+  struct Slab {
+    Node *nodes;
+    size_t used;
+  };
+  vector<Slab *> slabs;
+  size_t serial;
+  static unordered_map<size_t, Slab *> &current();
+};
+
+struct Node {
   string name;
   size_t id;
   double length;
@@ -41,10 +139,14 @@ struct Node {
   double varsum;
   Node *parent;
   Children children;
+  NodePool *pool; // the pool of node, NULL for the node by new
 
   size_t taxSize, taxLevel, nleaf, nxleaf,
       nUpLeaf; // nxleaf is the number of unclassfied leafs
   bool unclassified, uploaded, otu;
+  bool dirty;   // the lineage of branch to be renewed, so are its ancestors
+  uint32_t lng; // the id of lineage in theLngTable after annotation
+  uint32_t split; // the position of '|' in the lineage by the annotation
 
   Node();
   Node(size_t);
@@ -52,6 +154,20 @@ struct Node {
   Node(size_t, const vector<Node *> &);
 
   void clear();
+  Node *_newNode();
+
+  // the name of node, it is made of the lineage when the name is empty
+  string getName() const;
+
+  // traversals without recursion, the stack can be given for reuse
+  template <typename Visitor> void preorder(Visitor, vector<Node *> &);
+  template <typename Visitor> void preorder(Visitor);
+  template <typename Visitor>
+  void postorder(Visitor, vector<pair<Node *, size_t>> &);
+  template <typename Visitor> void postorder(Visitor);
+  template <typename Visitor> void forEachLeaf(Visitor, vector<Node *> &);
+  template <typename Visitor> void forEachLeaf(Visitor);
+
   void addChild(Node *);
   void deleteChild(Node *);
   void getDescendants(vector<Node *> &);
@@ -71,8 +187,10 @@ struct Node {
   void setOneLeaf(const string &, bool);
   void _setOneBranch();
   void setAllBranches();
+  void updateBranches();
+  void _setDirty();
   void setBranchLineage();
-  string _getBranchName(const vector<Node *> &);
+  uint32_t _getBranchLng(const vector<Node *> &);
   int nClade();
 
   void _getPrediction(string &);
@@ -98,35 +216,37 @@ struct Node {
   Node *_sibling();
   void infoTree();
 
-  void _madTree(const vector<Node *> &);
-  pair<double, double> getMAD();
-  void _getOTUad(vector<double> &, double &);
-
-  void _pmrTree(const vector<Node *> &);
-  pair<double, double> getPMR();
-  void _getOTUdepth(vector<double> &);
+  static size_t _bestCandidate(const vector<double> &, bool);
+  void _madTree(FlatTree &, const vector<Node *> &, const vector<size_t> &);
+  void _pmrTree(FlatTree &, const vector<Node *> &, const vector<size_t> &);
 
-  void _mdTree(const vector<Node *> &);
+  void _mdTree(FlatTree &, const vector<Node *> &, const vector<size_t> &);
   void _setLengthByMidpoint();
   void _getDepth();
+  void _getAllDepth();
 
-  void _mpTree();
-  void _getMaxPath(pair<double, vector<Node *>> &,
-                   pair<double, vector<Node *>> &);
+  void _mpTree(FlatTree &);
 
-  void _mvTree(const vector<Node *> &);
+  void _mvTree(FlatTree &, const vector<Node *> &, const vector<size_t> &);
   void _getVarSum();
+  void _getAllVarSum();
 
-  void _outnwk(ostream &); // output annotated tree
-  void _nwk(ostream &); // output only leaf name
-  static function<string(Node *)> nwkname;
+  void _nwkLabel(string &, NwkLabel);
+  void _outnwk(ostream &, NwkLabel);
   void outnwk(ostream &, bool annotated=true);
   void outnwk(const string &, bool annotated=true);
   void outitol(const string &);
-  void _innwk(istream &);
-  void _nwkItem(const string &);
+  void _nwkItem(const char *, const char *, bool);
+  const char *_innwk(const char *, const char *, vector<NwkSubtree> &);
+  const char *innwk(const char *, const char *, bool inParallel = false);
   void innwk(istream &);
-  void innwk(const string &);
+  void innwk(const string &, bool inParallel = false);
+  void intree(const string &, bool inParallel = false);
+
+  void outbin(ostream &);
+  void outbin(const string &);
+  void inbin(const char *, const char *);
+  void inbin(const string &);
 
   void _injson(istream &);
   void _getStr(istream &, string &);
@@ -136,6 +256,9 @@ struct Node {
   void outjson(ostream &);
   void outjson(const string &);
   void outjsonAbbr(ostream &);
+  void _outjson(ostream &, bool);
+  void _jsonItem(ostream &);
+  void _jsonAbbrItem(ostream &);
 
   void renewId(const unordered_map<string, size_t> &);
   void updateId(int &);
@@ -143,4 +266,75 @@ struct Node {
   void chgLeafName(const str2str &);
 };
 
+/********************************************************************************
+ * @brief the traversals of tree without recursion. In preorder, the visitor
+ * can return false to skip the descendants of the node.
+ *
+ ********************************************************************************/
+template <typename Visitor>
+void Node::preorder(Visitor visit, vector<Node *> &stack) {
+  stack.clear();
+  stack.emplace_back(this);
+  while (!stack.empty()) {
+    Node *nd = stack.back();
+    stack.pop_back();
+    if constexpr (is_same_v<invoke_result_t<Visitor &, Node *>, bool>) {
+      if (!visit(nd))
+        continue;
+    } else {
+      visit(nd);
+    }
+    stack.insert(stack.end(), nd->children.rbegin(), nd->children.rend());
+  }
+};
+
+template <typename Visitor> void Node::preorder(Visitor visit) {
+  vector<Node *> stack;
+  preorder(visit, stack);
+};
+
+template <typename Visitor>
+void Node::postorder(Visitor visit, vector<pair<Node *, size_t>> &stack) {
+  stack.clear();
+  stack.emplace_back(this, 0);
+  while (!stack.empty()) {
+    Node *nd = stack.back().first;
+    size_t i = stack.back().second;
+    if (i < nd->children.size()) {
+      stack.back().second++;
+      stack.emplace_back(nd->children[i], 0);
+    } else {
+      stack.pop_back();
+      visit(nd);
+    }
+  }
+};
+
+template <typename Visitor> void Node::postorder(Visitor visit) {
+  vector<pair<Node *, size_t>> stack;
+  postorder(visit, stack);
+};
+
+template <typename Visitor>
+void Node::forEachLeaf(Visitor visit, vector<Node *> &stack) {
+  preorder(
+      [&](Node *nd) {
+        if (nd->isLeaf())
+          visit(nd);
+      },
+      stack);
+};
+
+template <typename Visitor> void Node::forEachLeaf(Visitor visit) {
+  vector<Node *> stack;
+  forEachLeaf(visit, stack);
+};
+
+// check the head of binary tree
+bool isBinTree(const char *, const char *);
+
+// split the text of newick file with multiple trees
+size_t splitNwk(const char *, const char *,
+                vector<pair<const char *, const char *>> &);
+
 #endif
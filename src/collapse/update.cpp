@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of Sciences.
+ * See the accompanying Manual for the contributors and the way to cite this work.
+ * Comments and suggestions welcome. Please contact
+ * Dr. Guanghong Zuo <ghzuo@ucas.ac.cn>
+ * 
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 11:23:51
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 11:23:51
+ */
+
+#include "update.h"
+
+void update(int argc, char *argv[]) {
+
+  // get the input arguments
+  UpdateArgs myargs(argc, argv);
+
+  /************************************************************************
+   ******* read the annotated tree and renew the lineages of nodes ********/
+  TaxaRank rank;
+  rank.initial(myargs.rankfile, myargs.outrank);
+
+  NodePool pool;
+  Node *aTree = pool.newNode();
+  aTree->inbin(myargs.infile);
+
+  LngData tlngs(&rank);
+  reloadLineage(aTree, tlngs);
+  Taxa aTaxa(tlngs);
+  TreeUpdater updater(aTaxa, aTree);
+  theInfo("Reload the annotated tree with " + to_string(tlngs.size()) +
+          " leafs: " + myargs.infile);
+
+  // the leafs by their names
+  unordered_map<string, Node *> leafs;
+  aTree->forEachLeaf([&leafs](Node *nd) {
+    leafs.emplace(lastNameNoRankView(theLngTable[nd->lng]), nd);
+  });
+
+  /************************************************************************
+   ******* delete the leafs in the list ***********************************/
+  if (!myargs.delfile.empty()) {
+    ifstream is(myargs.delfile);
+    if (!is) {
+      cerr << "Cannot found the delete list file " << myargs.delfile << endl;
+      exit(4);
+    }
+
+    size_t nDel(0);
+    string line;
+    while (getline(is, line)) {
+      string name;
+      istringstream(line) >> name;
+      if (name.empty() || name[0] == '#')
+        continue;
+
+      auto iter = leafs.find(name);
+      if (iter == leafs.end()) {
+        theInfo("Cannot found the leaf to delete: " + name);
+      } else {
+        updater.deleteLeaf(iter->second);
+        leafs.erase(iter);
+        ++nDel;
+      }
+    }
+    theInfo("Deleted " + to_string(nDel) + " leafs from the tree");
+  }
+
+  /************************************************************************
+   ******* insert the leafs in the list beside their siblings *************/
+  if (!myargs.addfile.empty()) {
+    ifstream is(myargs.addfile);
+    if (!is) {
+      cerr << "Cannot found the insert list file " << myargs.addfile << endl;
+      exit(4);
+    }
+
+    // the name, the sibling and the branch length of the new leafs
+    vector<string> nmlist, sibling;
+    vector<double> length;
+    string line;
+    while (getline(is, line)) {
+      string name, sib;
+      double len(NAN);
+      istringstream(line) >> name >> sib >> len;
+      if (name.empty() || name[0] == '#')
+        continue;
+      if (sib.empty()) {
+        cerr << "No sibling of the inserted leaf: " << name << endl;
+        exit(4);
+      }
+      nmlist.emplace_back(name);
+      sibling.emplace_back(sib);
+      length.emplace_back(len);
+    }
+
+    // get the lineages of the new leafs
+    LngData lngs(&rank, myargs.taxadb, myargs.taxfile, myargs.taxrev);
+    vector<string> names(nmlist);
+    lngs.getLineage(names);
+
+    size_t nAdd(0);
+    for (size_t i = 0; i < nmlist.size(); ++i) {
+      auto iter = leafs.find(sibling[i]);
+      if (iter == leafs.end()) {
+        theInfo("Cannot found the sibling " + sibling[i] + " for leaf " +
+                nmlist[i]);
+      } else if (leafs.find(nmlist[i]) != leafs.end()) {
+        theInfo("The leaf is already in the tree: " + nmlist[i]);
+      } else {
+        double len = isnan(length[i]) ? iter->second->length : length[i];
+        Node *nd =
+            updater.insertLeaf(iter->second, lngs[i].name, lngs[i].def, len);
+        leafs.emplace(nmlist[i], nd);
+        ++nAdd;
+      }
+    }
+    theInfo("Inserted " + to_string(nAdd) + " leafs into the tree");
+  }
+  aTree = updater.tree;
+  theInfo("Done statistics of the taxonomy");
+
+  /***************************************************************************
+   *********  output data ****************************************************/
+  aTaxa.outStatitics(myargs.outPref + ".unit");
+  aTaxa.outEntropy(myargs.outPref + ".entropy");
+  aTree->outnwk(myargs.outPref + "-annotated" +
+                (myargs.gzip ? ".nwk.gz" : ".nwk"));
+  aTree->outbin(myargs.outPref + "-annotated.ctb");
+}
+/****************************************************************************
+ ******************************  End main program ***************************
+ ****************************************************************************/
+
+/**************************************************************************
+ * @brief renew the lineages of nodes by the names of the annotated tree
+ *
+ * @param aTree the annotated tree read from the binary file
+ * @param lngs the lineages of leafs for the taxonomy, with the rank context
+ *        whose out ranks are set by the lineages
+ ***************************************************************************/
+void reloadLineage(Node *aTree, LngData &lngs) {
+  aTree->preorder([&lngs](Node *nd) {
+    if (nd->isLeaf()) {
+      string nm(nd->name);
+      size_t pos = nm.find('|');
+      if (pos != string::npos)
+        nm.erase(pos, 1);
+      nd->setOneLeaf(nm, !nd->unclassified);
+      lngs.data.emplace_back(nm);
+      lngs.data.back().def = !nd->unclassified;
+    } else {
+      nd->unclassified = false;
+      nd->dirty = true;
+    }
+  });
+  aTree->updateBranches();
+
+  // the out ranks are the ranks in lineages, as the header of lineage file
+  string outRankStr;
+  vector<string_view> taxa;
+  for (auto &lng : lngs.data) {
+    taxa.clear();
+    separateLineage(string_view(lng.name), taxa);
+    size_t pos(0);
+    for (auto &tax : taxa) {
+      if (tax.size() < 3 || tax.front() != TaxaRank::mark.first)
+        continue;
+      char c = tax[1];
+      size_t i = outRankStr.find(c);
+      if (i == string::npos) {
+        outRankStr.insert(pos, 1, c);
+        i = pos;
+      }
+      pos = i + 1;
+    }
+  }
+
+  // only the rank with name is output
+  TaxaRank *rank = lngs.rank;
+  string theRanks;
+  for (auto c : outRankStr) {
+    if (c == 'T')
+      continue;
+    if (c == 'D' || any_of(rank->rankmap.begin(), rank->rankmap.end(),
+                           [c](auto &item) { return item.second == c; }))
+      theRanks += c;
+  }
+  rank->setOutRank(theRanks);
+};
+
+UpdateArgs::UpdateArgs(int argc, char **argv)
+    : infile(""), addfile(""), delfile(""), taxfile(""), taxrev(""),
+      gzip(false) {
+
+  program = argv[0];
+  string outname("updated");
+  string supdir("./");
+
+  char ch;
+  while ((ch = getopt(argc, argv, "i:a:x:d:D:o:S:r:R:l:Zqh")) != -1) {
+    switch (ch) {
+    case 'i':
+      infile = optarg;
+      break;
+    case 'a':
+      addfile = optarg;
+      break;
+    case 'x':
+      delfile = optarg;
+      break;
+    case 'D':
+      supdir = optarg;
+      break;
+    case 'd':
+      taxadb = optarg;
+      break;
+    case 'o':
+      outname = optarg;
+      break;
+    case 'S':
+      taxrev = optarg;
+      break;
+    case 'r':
+      outrank = optarg;
+      break;
+    case 'R':
+      rankfile = optarg;
+      break;
+    case 'l':
+      taxfile = optarg;
+      break;
+    case 'Z':
+      gzip = true;
+      break;
+    case 'q':
+      theInfo.quiet = true;
+      break;
+    case 'h':
+      usage();
+    case '?':
+      usage();
+    }
+  }
+
+  // the workdir
+  addsuffix(supdir, '/');
+
+  // the input annotated tree
+  if (infile.empty())
+    infile = supdir + "collapsed-annotated.ctb";
+
+  // the input lineage file
+  if (taxfile.empty()) {
+    taxfile = supdir + "Lineage.lns";
+    if (!fileExists(taxfile))
+      taxfile = supdir + "Lineage.csv";
+  }
+
+  // the output prefix
+  outPref = supdir + outname;
+
+  // for the default
+  if (taxadb.empty()) {
+    taxadb = supdir + "taxadb.gz";
+    if (!fileExists(taxadb)) {
+      taxadb = supdir + "taxdump.tar.gz";
+      if (!fileExists(taxadb)) {
+        taxadb = supdir + "taxdump/";
+      }
+    }
+  }
+}
+
+void UpdateArgs::usage() {
+  cerr
+      << "\nProgram Usage: \n\n"
+      << program << "\n"
+      << " [ -D ./ ]              The work directory, default: ./\n"
+      << " [ -i collapsed-annotated.ctb ]\n"
+      << "                        Input annotated tree in binary format,\n"
+      << "                        default: collapsed-annotated.ctb\n"
+      << " [ -a <None> ]          List of inserted leafs, one per line:\n"
+      << "                        <name> <sibling> [branch length]\n"
+      << " [ -x <None> ]          List of deleted leafs, one name per line\n"
+      << " [ -o updated ]         Set prefix name of output files, \n"
+      << "                        default: updated\n"
+      << " [ -S <None> ]          Set batch lineage substitute file,\n"
+      << "                        default: None\n"
+      << " [ -l Lineage.lns ]     Input lineage file for inserted leaves, \n"
+      << "                        default: Lineage.lns or Lineage.csv\n"
+      << " [ -d taxadb.gz ]       Taxonomy data file or directory,\n"
+      << "                        default: taxadb.gz or taxdump.tar.gz\n"
+      << " [ -R <None> ]          List of rank names and abbrivations,\n"
+      << "                        default: set by program\n"
+      << " [ -r DKPCOFGS ]        Abbreviations of output taxon rank,\n"
+      << "                        default: set by program\n"
+      << " [ -Z ]                 Output the newick tree in gzip format\n"
+      << " [ -q ]                 Run command in quiet mode\n"
+      << " [ -h ]                 Display this information\n"
+      << endl;
+  exit(1);
+}
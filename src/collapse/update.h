@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of Sciences.
+ * See the accompanying Manual for the contributors and the way to cite this work.
+ * Comments and suggestions welcome. Please contact
+ * Dr. Guanghong Zuo <ghzuo@ucas.ac.cn>
+ * 
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 11:20:31
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 11:20:31
+ */
+
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include "kit.h"
+#include "taxsys.h"
+#include "taxtree.h"
+using namespace std;
+
+// read arguments
+struct UpdateArgs {
+  string program;
+  string infile;
+  string addfile, delfile;
+  string taxadb, taxfile, taxrev;
+  string rankfile, outrank;
+  string outPref;
+  bool gzip;
+
+  UpdateArgs(int, char **);
+  void usage();
+};
+
+void update(int, char **);
+void reloadLineage(Node *, LngData &);
+
+#endif
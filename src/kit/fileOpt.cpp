@@ -67,6 +67,170 @@ bool gzvalid(const string &filename) {
   return false;
 };
 
+/********************************************************************************
+ * @brief stream on file by zlib
+ *
+ ********************************************************************************/
+const size_t GZBUFSIZE(1 << 17);
+
+GzStreamBuf::GzStreamBuf(const string &filename, bool toWrite)
+    : writing(toWrite), buf(GZBUFSIZE) {
+  // write plain file by transparent mode without .gz suffix
+  const char *mode = "rb";
+  if (writing)
+    mode = hasSuffix(filename, ".gz") ? "wb" : "wT";
+
+  fp = gzopen(filename.c_str(), mode);
+  if (fp != NULL)
+    gzbuffer(fp, GZBUFSIZE);
+
+  if (writing)
+    setp(buf.data(), buf.data() + buf.size());
+  else
+    setg(buf.data(), buf.data(), buf.data());
+};
+
+GzStreamBuf::~GzStreamBuf() { close(); };
+
+bool GzStreamBuf::good() const { return fp != NULL; };
+
+void GzStreamBuf::close() {
+  if (fp != NULL) {
+    sync();
+    gzclose(fp);
+    fp = NULL;
+  }
+};
+
+GzStreamBuf::int_type GzStreamBuf::underflow() {
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+  if (fp == NULL || writing)
+    return traits_type::eof();
+
+  int n = gzread(fp, buf.data(), buf.size());
+  if (n <= 0)
+    return traits_type::eof();
+  setg(buf.data(), buf.data(), buf.data() + n);
+  return traits_type::to_int_type(*gptr());
+};
+
+GzStreamBuf::int_type GzStreamBuf::overflow(int_type c) {
+  if (sync() != 0)
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+};
+
+int GzStreamBuf::sync() {
+  if (!writing)
+    return 0;
+  if (fp == NULL)
+    return -1;
+
+  int n = pptr() - pbase();
+  if (n > 0 && gzwrite(fp, pbase(), n) != n)
+    return -1;
+  setp(buf.data(), buf.data() + buf.size());
+  return 0;
+};
+
+igzstream::igzstream(const string &filename)
+    : istream(NULL), gzbuf(filename, false) {
+  rdbuf(&gzbuf);
+  if (!gzbuf.good())
+    setstate(ios::failbit);
+};
+
+void igzstream::close() { gzbuf.close(); };
+
+ogzstream::ogzstream(const string &filename)
+    : ostream(NULL), gzbuf(filename, true) {
+  rdbuf(&gzbuf);
+  if (!gzbuf.good())
+    setstate(ios::failbit);
+};
+
+void ogzstream::close() {
+  flush();
+  gzbuf.close();
+};
+
+/********************************************************************************
+ * @brief read only memory map of a whole file
+ *
+ ********************************************************************************/
+MapFile::MapFile(const string &filename)
+    : fd(-1), mapped(false), data(NULL), size(0) {
+  if ((fd = open(filename.c_str(), O_RDONLY)) == -1)
+    return;
+
+  struct stat fileInfo;
+  if (fstat(fd, &fileInfo) != 0) {
+    close(fd);
+    fd = -1;
+    return;
+  }
+
+  // an empty file is valid but has nothing to map
+  size = fileInfo.st_size;
+  if (size > 0) {
+    void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      fd = -1;
+      size = 0;
+      return;
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);
+    data = (const char *)addr;
+    mapped = true;
+  }
+
+  // inflate the gzip file by its magic number
+  if (size > 1 && data[0] == '\x1f' && data[1] == '\x8b') {
+    gzFile fp = gzopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+      cerr << "Cannot open the gzip file " << filename << endl;
+      exit(1);
+    }
+    gzbuffer(fp, GZBUFSIZE);
+    vector<char> buf(GZBUFSIZE);
+    int n;
+    while ((n = gzread(fp, buf.data(), buf.size())) > 0)
+      inflated.append(buf.data(), n);
+
+    // a broken or truncated stream is an error, not the end of file, and
+    // the message of gzerror begins with the file name
+    int err(Z_OK);
+    const char *msg = gzerror(fp, &err);
+    if (n < 0 || err != Z_OK) {
+      cerr << "Failed to inflate the gzip file " << msg << endl;
+      exit(1);
+    }
+    gzclose(fp);
+
+    munmap((void *)data, size);
+    mapped = false;
+    data = inflated.data();
+    size = inflated.size();
+  }
+};
+
+MapFile::~MapFile() {
+  if (mapped)
+    munmap((void *)data, size);
+  if (fd != -1)
+    close(fd);
+};
+
+bool MapFile::good() const { return fd != -1; };
+const char *MapFile::begin() const { return data; };
+const char *MapFile::end() const { return data + size; };
+
 // read list file for list and name map
 void readNameMap(const string &file, vector<string> &nmlist,
                  map<string, string> &nameMap) {
@@ -13,10 +13,14 @@
 #ifndef FILEOPT_H
 #define FILEOPT_H
 
+#include <fcntl.h>
 #include <iostream>
+#include <map>
 #include <string>
+#include <streambuf>
+#include <sys/mman.h>
+#include <vector>
 #include <zlib.h>
-#include <map>
 #include "stringOpt.h"
 using namespace std;
 
@@ -58,6 +62,66 @@ int gzline(gzFile &, string &);
 // check gzip file empty
 bool gzvalid(const string&);
 
+/********************************************************************************
+ * @brief stream on file by zlib, the file with .gz suffix is written in gzip
+ * and both gzip and plain files can be read
+ *
+ ********************************************************************************/
+class GzStreamBuf : public streambuf {
+public:
+  GzStreamBuf(const string &, bool);
+  ~GzStreamBuf();
+  bool good() const;
+  void close();
+
+protected:
+  int_type underflow() override;
+  int_type overflow(int_type) override;
+  int sync() override;
+
+private:
+  gzFile fp;
+  bool writing;
+  vector<char> buf;
+};
+
+struct igzstream : public istream {
+  GzStreamBuf gzbuf;
+  igzstream(const string &);
+  void close();
+};
+
+struct ogzstream : public ostream {
+  GzStreamBuf gzbuf;
+  ogzstream(const string &);
+  void close();
+};
+
+/********************************************************************************
+ * @brief read only memory map of a whole file, the gzip file is inflated
+ * into memory. So a gzip file takes the memory of its whole inflated text,
+ * which is kept for the parsers on a continuous range, while a stream by
+ * igzstream takes only its buffer. The broken gzip file is an error.
+ *
+ ********************************************************************************/
+struct MapFile {
+  MapFile(const string &);
+  ~MapFile();
+  MapFile(const MapFile &) = delete;
+  MapFile &operator=(const MapFile &) = delete;
+
+  bool good() const;
+  const char *begin() const;
+  const char *end() const;
+
+private:
+  int fd;
+  bool mapped;
+  const char *data;
+  size_t size;
+  string inflated;
+};
+
 // read list file for list and name map
 void readNameMap(const string&, vector<string>&, map<string,string>&);
 
@@ -42,6 +42,8 @@ Info::~Info() {
 }
 
 void Info::operator()(const string &str, int idep) {
+  // keep the messages from threads in whole lines
+#pragma omp critical(theInfo)
   if (!quiet) {
     if (idep > 0)
       dep += idep;
@@ -13,6 +13,22 @@
 
 #include "ompOpt.h"
 
+int nThreads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+};
+
+int threadId() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+};
+
 OMP4TriAngleLoop::OMP4TriAngleLoop(long N) {
   inBeg = 0;
   if (N % 2 == 0) {
@@ -15,9 +15,18 @@
 #define OMPOPT_H
 
 #include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
+// the number of threads for parallel sections
+int nThreads();
+
+// the index of current thread
+int threadId();
+
 /********************************************************************************
  * @brief options for three angle 
  * 
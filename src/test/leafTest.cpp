@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of
+ * Sciences. See the accompanying Manual for the contributors and the way to
+ * cite this work. Comments and suggestions welcome. Please contact Dr.
+ * Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 21:12:40
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 21:12:40
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "getLeafName.h"
+using namespace std;
+
+/********************************************************************************
+ * @brief the leaf names of an annotated tree are the same for the binary and
+ * the newick files, the part after '|' of the lineage, and a '|' in the
+ * lineage of taxon is kept
+ ********************************************************************************/
+int main() {
+  NodePool pool;
+  Node *aTree = pool.newNode();
+  aTree->name = "|<D>Archaea";
+
+  vector<string> lngs{
+      "<D>Archaea|<P>Nanobdellota<G>Nanobdella<T>LC658659",
+      "<D>Archaea<P>Methanobacteriota|<G>Acidiplasma<T>AY907888",
+      "<D>Archaea<P>Methanobacteriota|<F>|Oxalobacteraceae<T>JAMKYL01",
+      "AB602437"};
+  vector<string> expect{"<P>Nanobdellota<G>Nanobdella<T>LC658659",
+                        "<G>Acidiplasma<T>AY907888",
+                        "<F>|Oxalobacteraceae<T>JAMKYL01", "AB602437"};
+
+  Node *branch = pool.newNode();
+  branch->name = "<D>Archaea|<P>Methanobacteriota";
+  for (size_t i = 0; i < lngs.size(); ++i) {
+    Node *leaf = pool.newNode();
+    leaf->name = lngs[i];
+    leaf->length = 0.1 * (i + 1);
+    (i == 0 ? aTree : branch)->addChild(leaf);
+  }
+  aTree->addChild(branch);
+  size_t id(0);
+  aTree->preorder([&id](Node *nd) { nd->id = id++; });
+
+  aTree->outnwk("leafTest-annotated.nwk");
+  aTree->outbin("leafTest-annotated.ctb");
+
+  vector<string> nwkNames, binNames;
+  getAllLeaf("leafTest-annotated.nwk", nwkNames);
+  getAllLeaf("leafTest-annotated.ctb", binNames);
+
+  if (nwkNames != expect || binNames != expect) {
+    cerr << "The leaf names of the newick and the binary tree are different:"
+         << endl;
+    for (size_t i = 0; i < max(nwkNames.size(), binNames.size()); ++i)
+      cerr << (i < nwkNames.size() ? nwkNames[i] : "") << "\t"
+           << (i < binNames.size() ? binNames[i] : "") << endl;
+    exit(1);
+  }
+  cout << "All " << expect.size() << " leaf names agree for both formats"
+       << endl;
+  return 0;
+};
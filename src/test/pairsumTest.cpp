@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of
+ * Sciences. See the accompanying Manual for the contributors and the way to
+ * cite this work. Comments and suggestions welcome. Please contact Dr.
+ * Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 18:40:12
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 23:32:05
+ */
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pairsum.h"
+using namespace std;
+
+/********************************************************************************
+ * @brief the sums by each vector kernel supported by the cpu, and by the
+ * dispatch of sumPairs, agree with the scalar loop: the sums within a
+ * relative tolerance (NaN for both is agreed) and the number of zero length
+ * pairs exactly
+ ********************************************************************************/
+static bool agree(double a, double b, double scale) {
+  if (std::isnan(a) || std::isnan(b))
+    return std::isnan(a) && std::isnan(b);
+  return fabs(a - b) <= 1e-10 * (fabs(b) + scale);
+};
+
+static bool checkSum(const PairSum &v, const PairSum &s, double maxd,
+                     const string &label) {
+  double w = std::isnan(s.w) ? 0 : s.w;
+  bool good = agree(v.w, s.w, 0) && agree(v.wd, s.wd, w * maxd) &&
+              agree(v.rd, s.rd, 0) && agree(v.rx, s.rx, 0) &&
+              v.nzero == s.nzero;
+  if (!good) {
+    cerr << "Failed for " << label << ": w " << v.w << "/" << s.w << ", wd "
+         << v.wd << "/" << s.wd << ", rd " << v.rd << "/" << s.rd << ", rx "
+         << v.rx << "/" << s.rx << ", nzero " << v.nzero << "/" << s.nzero
+         << endl;
+  }
+  return good;
+};
+
+static bool checkPairs(const vector<double> &x, const vector<double> &y,
+                       const string &label) {
+  PairSum s;
+  sumPairsScalar(x.data(), x.size(), y.data(), y.size(), s);
+
+  // the scale of the terms for the sums with the cancellation of signs
+  double maxd = 0;
+  for (auto a : x)
+    for (auto b : y)
+      if (!std::isnan(a - b))
+        maxd = max(maxd, fabs(a - b));
+
+  string size = " with " + to_string(x.size()) + "x" + to_string(y.size());
+  bool good = true;
+  for (auto &k : pairKernels()) {
+    if (!k.supported)
+      continue;
+    PairSum v;
+    k.kernel(x.data(), x.size(), y.data(), y.size(), v);
+    good &= checkSum(v, s, maxd, label + " by " + k.name + size);
+  }
+
+  PairSum v;
+  sumPairs(x.data(), x.size(), y.data(), y.size(), v);
+  good &= checkSum(v, s, maxd, label + " by sumPairs" + size);
+  return good;
+};
+
+int main() {
+  mt19937_64 gen(2026);
+  uniform_real_distribution<double> unif(0.0, 1.0);
+  size_t nfail(0), ntest(0);
+
+  // the kernels not supported by the cpu are skipped
+  for (auto &k : pairKernels()) {
+    if (!k.supported)
+      cout << "Skip the " << k.name << " kernel, not supported by the cpu"
+           << endl;
+  }
+
+  // the random distances, the lengths are not multiples of the lanes and
+  // either list can be the longer one (the flip of the sums)
+  for (size_t nx = 1; nx <= 19; ++nx) {
+    for (size_t ny = 1; ny <= 19; ++ny) {
+      vector<double> x(nx), y(ny);
+      for (auto &a : x)
+        a = unif(gen);
+      for (auto &b : y)
+        b = unif(gen);
+      ++ntest;
+      nfail += !checkPairs(x, y, "random");
+    }
+  }
+
+  // the zero length pairs by zero, negative zero and opposite distances,
+  // and the negative lengths are out of rd
+  for (size_t k = 0; k < 200; ++k) {
+    size_t nx = 1 + gen() % 23, ny = 1 + gen() % 23;
+    vector<double> x(nx), y(ny);
+    for (auto &a : x) {
+      size_t c = gen() % 4;
+      a = c == 0 ? 0.0 : c == 1 ? -0.0 : c == 2 ? -0.5 : unif(gen);
+    }
+    for (auto &b : y) {
+      size_t c = gen() % 4;
+      b = c == 0 ? 0.0 : c == 1 ? -0.0 : c == 2 ? 0.5 : unif(gen);
+    }
+    ++ntest;
+    nfail += !checkPairs(x, y, "zero");
+  }
+
+  // the NaN distances, the NaN pairs are not counted as zero and not in rd
+  for (size_t k = 0; k < 50; ++k) {
+    size_t nx = 1 + gen() % 13, ny = 1 + gen() % 13;
+    vector<double> x(nx), y(ny);
+    for (auto &a : x)
+      a = gen() % 5 == 0 ? NAN : unif(gen);
+    for (auto &b : y)
+      b = gen() % 5 == 0 ? NAN : gen() % 3 == 0 ? 0.0 : unif(gen);
+    ++ntest;
+    nfail += !checkPairs(x, y, "nan");
+  }
+
+  if (nfail > 0) {
+    cerr << nfail << " of " << ntest << " checks of pair sums failed" << endl;
+    exit(1);
+  }
+  cout << "All " << ntest << " checks of pair sums passed" << endl;
+  return 0;
+};
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2022  Wenzhou Institute, University of Chinese Academy of
+ * Sciences. See the accompanying Manual for the contributors and the way to
+ * cite this work. Comments and suggestions welcome. Please contact Dr.
+ * Guanghong Zuo <ghzuo@ucas.ac.cn>
+ *
+ * @Author: Dr. Guanghong Zuo
+ * @Date: 2026-10-18 22:05:31
+ * @Last Modified By: Dr. Guanghong Zuo
+ * @Last Modified Time: 2026-10-18 23:48:19
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flattree.h"
+using namespace std;
+
+/********************************************************************************
+ * @brief a random unrooted tree with multifurcating nodes, the nodes have
+ * two to five children and the root has three
+ ********************************************************************************/
+static string randomTree(size_t nleaf, mt19937_64 &gen) {
+  uniform_real_distribution<double> unif(0.01, 1.0);
+  vector<string> nodes;
+  for (size_t i = 0; i < nleaf; ++i)
+    nodes.emplace_back("L" + to_string(i) + ":" + to_string(unif(gen)));
+
+  while (nodes.size() > 3) {
+    size_t k = 2 + gen() % 4;
+    k = min(k, nodes.size() - 2);
+    shuffle(nodes.begin(), nodes.end(), gen);
+    string str("(" + nodes.back());
+    nodes.pop_back();
+    for (size_t i = 1; i < k; ++i) {
+      str += "," + nodes.back();
+      nodes.pop_back();
+    }
+    nodes.emplace_back(str + "):" + to_string(unif(gen)));
+  }
+  return "(" + strjoin(nodes.begin(), nodes.end(), ',') + ");";
+};
+
+/********************************************************************************
+ * @brief a caterpillar tree, each inner node has a leaf and the next inner
+ * node as children, so the tree is as deep as the number of leafs
+ ********************************************************************************/
+static string caterpillarTree(size_t nleaf, mt19937_64 &gen) {
+  uniform_real_distribution<double> unif(0.01, 1.0);
+  string str(nleaf - 2, '(');
+  str += "L0:" + to_string(unif(gen));
+  for (size_t i = 1; i < nleaf - 2; ++i)
+    str += ",L" + to_string(i) + ":" + to_string(unif(gen)) +
+           "):" + to_string(unif(gen));
+  for (size_t i = nleaf - 2; i < nleaf; ++i)
+    str += ",L" + to_string(i) + ":" + to_string(unif(gen));
+  return str + ");";
+};
+
+/********************************************************************************
+ * @brief the distances from all nodes of a tree to its leafs by brute force.
+ * The leafs are indexed by the order of names, so the trees with the same
+ * leafs are compared by the index.
+ ********************************************************************************/
+struct Metric {
+  vector<Node *> nodes;
+  vector<size_t> leafNode;
+  vector<vector<double>> dist;
+
+  // the branches: the node above, the node below and the length
+  vector<tuple<size_t, size_t, double>> branches;
+
+  Metric(Node *root) {
+    unordered_map<Node *, size_t> index;
+    root->preorder([&](Node *nd) {
+      index.emplace(nd, nodes.size());
+      nodes.emplace_back(nd);
+    });
+
+    vector<vector<pair<size_t, double>>> adj(nodes.size());
+    vector<pair<string, size_t>> leafs;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      Node *nd = nodes[i];
+      if (nd->parent != NULL) {
+        size_t p = index[nd->parent];
+        adj[i].emplace_back(p, nd->length);
+        adj[p].emplace_back(i, nd->length);
+        branches.emplace_back(p, i, nd->length);
+      }
+      if (nd->isLeaf())
+        leafs.emplace_back(nd->name, i);
+    }
+    sort(leafs.begin(), leafs.end());
+    for (auto &lf : leafs)
+      leafNode.emplace_back(lf.second);
+
+    dist.assign(nodes.size(), vector<double>(nleaf(), 0));
+    for (size_t k = 0; k < nleaf(); ++k) {
+      vector<pair<size_t, size_t>> stack{{leafNode[k], leafNode[k]}};
+      while (!stack.empty()) {
+        size_t i = stack.back().first, from = stack.back().second;
+        stack.pop_back();
+        for (auto &e : adj[i]) {
+          if (e.first != from) {
+            dist[e.first][k] = dist[i][k] + e.second;
+            stack.emplace_back(e.first, i);
+          }
+        }
+      }
+    }
+  };
+
+  size_t nleaf() const { return leafNode.size(); };
+
+  // the distances from the leafs to a root on the branch from u to v, at x
+  // from u
+  vector<double> rootDist(size_t u, size_t v, double len, double x) const {
+    vector<double> dr(nleaf());
+    for (size_t k = 0; k < nleaf(); ++k)
+      dr[k] = dist[u][k] < dist[v][k] ? dist[u][k] + x
+                                      : dist[v][k] + len - x;
+    return dr;
+  };
+
+  // the ancestor deviation of all pairs of leafs by the distances to root,
+  // the distance from a leaf to the common ancestor of a pair is half of
+  // the pair path with the difference of their distances to root
+  double mad(const vector<double> &dr) const {
+    double sum = 0;
+    for (size_t k = 0; k < nleaf(); ++k) {
+      for (size_t l = k + 1; l < nleaf(); ++l) {
+        double len = dist[leafNode[k]][l];
+        if (len > 0) {
+          double r = (dr[k] - dr[l]) / len;
+          sum += r * r;
+        }
+      }
+    }
+    return sum;
+  };
+
+  // the split of the minimal ancestor deviation on the branch from u to v
+  double madSplit(size_t u, size_t v, double len) const {
+    double sumx = 0, sumy = 0;
+    for (size_t k = 0; k < nleaf(); ++k) {
+      if (dist[u][k] > dist[v][k])
+        continue;
+      for (size_t l = 0; l < nleaf(); ++l) {
+        if (dist[u][l] < dist[v][l])
+          continue;
+        double c = dist[v][l] + len - dist[u][k];
+        double w = 1 / ((dist[u][k] + len + dist[v][l]) *
+                        (dist[u][k] + len + dist[v][l]));
+        sumx += c * w;
+        sumy += w;
+      }
+    }
+    return max(0.0, min(len, sumx * 0.5 / sumy));
+  };
+};
+
+static bool near(double a, double b) {
+  return fabs(a - b) <= 1e-8 * (fabs(a) + fabs(b) + 1);
+};
+
+static bool near(const vector<double> &a, const vector<double> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t k = 0; k < a.size(); ++k)
+    if (!near(a[k], b[k]))
+      return false;
+  return true;
+};
+
+/********************************************************************************
+ * @brief the reference roots by brute force on the branches of the unrooted
+ * tree: the distances from the leafs to the best root of each method
+ ********************************************************************************/
+static vector<double> madRoot(const Metric &ref) {
+  vector<double> best;
+  double minMAD = numeric_limits<double>::max();
+  for (auto &br : ref.branches) {
+    auto [u, v, len] = br;
+    vector<double> dr = ref.rootDist(u, v, len, ref.madSplit(u, v, len));
+    double mad = ref.mad(dr);
+    if (mad < minMAD) {
+      minMAD = mad;
+      best = dr;
+    }
+  }
+  return best;
+};
+
+// the most pairs across the branch with the midpoint on it, and the root
+// at the mean of these midpoints
+static vector<double> pmrRoot(const Metric &ref) {
+  vector<double> best;
+  double maxPMR = 0;
+  for (auto &br : ref.branches) {
+    auto [u, v, len] = br;
+    size_t n = 0, nu = 0, nv = 0;
+    double sum = 0;
+    for (size_t k = 0; k < ref.nleaf(); ++k) {
+      if (ref.dist[u][k] > ref.dist[v][k]) {
+        ++nv;
+        continue;
+      }
+      ++nu;
+      for (size_t l = 0; l < ref.nleaf(); ++l) {
+        if (ref.dist[u][l] < ref.dist[v][l])
+          continue;
+        double half = 0.5 * (ref.dist[u][k] + len + ref.dist[v][l]);
+        if (half > ref.dist[u][k] && half < ref.dist[u][k] + len) {
+          ++n;
+          sum += half - ref.dist[u][k];
+        }
+      }
+    }
+    double pmr = double(n) / (nu * nv);
+    if (pmr > maxPMR) {
+      maxPMR = pmr;
+      best = ref.rootDist(u, v, len, sum / n);
+    }
+  }
+  return best;
+};
+
+// the root at the midpoint of the mean depths of two sides, the minimal
+// mean depth (or variation) with both root branches positive is preferred
+static vector<double> midRoot(const Metric &ref, bool variation) {
+  vector<double> best, bestPlus;
+  double minScore = numeric_limits<double>::max(), minPlus = minScore;
+  for (auto &br : ref.branches) {
+    auto [u, v, len] = br;
+    double du = 0, dv = 0;
+    size_t nu = 0, nv = 0;
+    for (size_t k = 0; k < ref.nleaf(); ++k) {
+      if (ref.dist[u][k] < ref.dist[v][k]) {
+        du += ref.dist[u][k];
+        ++nu;
+      } else {
+        dv += ref.dist[v][k];
+        ++nv;
+      }
+    }
+    double x = 0.5 * (dv / nv + len - du / nu);
+    x = max(0.0, min(len, x));
+    vector<double> dr = ref.rootDist(u, v, len, x);
+
+    double mean = 0, var = 0;
+    for (auto d : dr)
+      mean += d;
+    mean /= dr.size();
+    for (auto d : dr)
+      var += (d - mean) * (d - mean);
+    double score = variation ? var : mean;
+
+    if (score < minScore) {
+      minScore = score;
+      best = dr;
+    }
+    if (x > 0 && x < len && score < minPlus) {
+      minPlus = score;
+      bestPlus = dr;
+    }
+  }
+  return bestPlus.empty() ? best : bestPlus;
+};
+
+// the midpoint of the path between the farthest pair of leafs
+static vector<double> mpRoot(const Metric &ref) {
+  size_t a = 0, b = 0;
+  for (size_t k = 0; k < ref.nleaf(); ++k) {
+    for (size_t l = k + 1; l < ref.nleaf(); ++l) {
+      if (ref.dist[ref.leafNode[k]][l] > ref.dist[ref.leafNode[a]][b]) {
+        a = k;
+        b = l;
+      }
+    }
+  }
+  double half = 0.5 * ref.dist[ref.leafNode[a]][b];
+  for (auto &br : ref.branches) {
+    auto [u, v, len] = br;
+    if (ref.dist[u][a] > ref.dist[v][a])
+      swap(u, v);
+    if (ref.dist[u][b] < ref.dist[v][b])
+      continue;
+    if (ref.dist[u][a] <= half && ref.dist[u][a] + len >= half)
+      return ref.rootDist(u, v, len, half - ref.dist[u][a]);
+  }
+  return vector<double>();
+};
+
+/********************************************************************************
+ * @brief the ancestor deviation and split of every branch by the flat tree
+ * are the same as by brute force, the tree is rooted as by the rooting and
+ * the branch of root is from the other child of root
+ ********************************************************************************/
+static size_t checkFlatMAD(Node *aTree, const Metric &ref) {
+  FlatTree flat(aTree);
+  vector<pair<double, double>> mad;
+  flat.getMAD(mad);
+
+  unordered_map<Node *, size_t> index;
+  for (size_t i = 0; i < ref.nodes.size(); ++i)
+    index.emplace(ref.nodes[i], i);
+
+  size_t nfail = 0;
+  for (size_t i = 1; i < flat.size(); ++i) {
+    size_t u = index[flat.nodes[flat.parent[i]]];
+    size_t v = index[flat.nodes[i]];
+    double len = flat.length[i];
+    if (flat.rootSibling(i) != FlatTree::NONE) {
+      u = index[flat.nodes[flat.rootSibling(i)]];
+      len += flat.length[flat.rootSibling(i)];
+    }
+    double doi = ref.madSplit(u, v, len);
+    double dev = ref.mad(ref.rootDist(u, v, len, doi));
+    if (!near(mad[i].first, doi) || !near(mad[i].second, dev)) {
+      cerr << "Failed for the flat MAD of branch " << i << ": split "
+           << mad[i].first << "/" << doi << ", deviation " << mad[i].second
+           << "/" << dev << endl;
+      ++nfail;
+    }
+  }
+  return nfail;
+};
+
+/********************************************************************************
+ * @brief the rooting by branch length keeps all leafs of the tree, the rooted
+ * tree is bifurcating at the root, and the root is at the same point as by
+ * brute force
+ ********************************************************************************/
+int main() {
+  theInfo.quiet = true;
+  mt19937_64 gen(2026);
+  size_t nfail(0), ntest(0);
+
+  // the random trees and a deep one
+  vector<pair<string, size_t>> trees;
+  for (size_t k = 0; k < 20; ++k)
+    trees.emplace_back(randomTree(120, gen), 120);
+  trees.emplace_back(caterpillarTree(400, gen), 400);
+
+  for (size_t k = 0; k < trees.size(); ++k) {
+    auto [nwk, nleaf] = trees[k];
+
+    NodePool refPool;
+    Node *refTree = refPool.newNode();
+    istringstream refIs(nwk);
+    refTree->innwk(refIs);
+    refTree = refTree->_forceRooting(refTree);
+    refTree->_getAllDepth();
+    ++ntest;
+    nfail += checkFlatMAD(refTree, Metric(refTree)) > 0;
+
+    // the references are on the unrooted tree, each candidate is a branch
+    NodePool unrootedPool;
+    Node *unrooted = unrootedPool.newNode();
+    istringstream unrootedIs(nwk);
+    unrooted->innwk(unrootedIs);
+    Metric ref(unrooted);
+    unordered_map<string, vector<double>> refRoot{
+        {"mv", midRoot(ref, true)}, {"md", midRoot(ref, false)},
+        {"mp", mpRoot(ref)},        {"pmr", pmrRoot(ref)},
+        {"mad", madRoot(ref)}};
+
+    for (auto meth : {"mv", "md", "mp", "pmr", "mad"}) {
+      NodePool pool;
+      Node *aTree = pool.newNode();
+      istringstream is(nwk);
+      aTree->innwk(is);
+      aTree = aTree->rootingByLength(meth);
+
+      vector<Node *> leafs;
+      aTree->getLeafs(leafs);
+      vector<string> names;
+      for (auto nd : leafs)
+        names.emplace_back(nd->name);
+      sort(names.begin(), names.end());
+      names.erase(unique(names.begin(), names.end()), names.end());
+
+      ++ntest;
+      if (leafs.size() != nleaf || names.size() != nleaf ||
+          aTree->children.size() != 2) {
+        cerr << "Failed for " << meth << " on tree " << k << ": "
+             << leafs.size() << " leafs, " << names.size()
+             << " names and " << aTree->children.size()
+             << " children of root" << endl;
+        ++nfail;
+        continue;
+      }
+
+      // the distances from leafs to the root fix the branch and the split
+      Metric out(aTree);
+      const vector<double> &dr = out.dist[0];
+      const vector<double> &expect = refRoot[meth];
+      ++ntest;
+      if (!near(dr, expect)) {
+        cerr << "Failed for the root of " << meth << " on tree " << k
+             << ": deviation " << out.mad(dr) << "/" << ref.mad(expect)
+             << endl;
+        ++nfail;
+      }
+    }
+  }
+
+  if (nfail > 0) {
+    cerr << nfail << " of " << ntest << " checks of rooting failed" << endl;
+    exit(1);
+  }
+  cout << "All " << ntest << " checks of rooting passed" << endl;
+  return 0;
+};